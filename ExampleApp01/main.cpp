@@ -1,12 +1,20 @@
 #include <cstdio>
+#include <cstring>
 #include <iostream>
+#include <string>
 
-#include "..\ProfilerLib\profilerlib.hpp"
+#include "../ProfilerLib/profilerlib.hpp"
 
 //#define LOG(STR) std::cout << STR
 #define LOG(STR)
 
-__declspec(noinline) void testNoInline() {
+#ifdef _MSC_VER
+#define NOINLINE __declspec(noinline)
+#else
+#define NOINLINE __attribute__((noinline))
+#endif
+
+NOINLINE void testNoInline() {
     LOG("No-Inline\n");
 }
 
@@ -81,6 +89,11 @@ void mymain() {
 }
 
 int main(int argc, char* argv[]) {
+    // '--dump <prefix>': no symbol is resolved in-process (see 'profiler-symbolize')
+    const char* dumpPrefix = (argc > 2 && strcmp(argv[1], "--dump") == 0) ? argv[2] : nullptr;
+    if (dumpPrefix != nullptr)
+        profiler::SetSymbolMode(profiler::SymbolMode::Deferred);
+    profiler::SetCallTreeCapture(true);
     LOG("[PROFILER ENABLED]\n");
     profiler::Enable();
     for (int i = 0; i < 100'000; ++i) {
@@ -90,9 +103,17 @@ int main(int argc, char* argv[]) {
     }
     profiler::Disable();
     LOG("[PROFILER DISABLED]\n");
+    if (dumpPrefix != nullptr) {
+        std::string prefix = dumpPrefix;
+        profiler::DumpHistory(profiler::GetFrameHistory(), (prefix + ".history").c_str());
+        profiler::DumpStats(profiler::GetStatsTable(), (prefix + ".stats").c_str());
+        return 0;
+    }
     printf("\n[HISTORY]\n");
     profiler::LogHistory(profiler::GetFrameHistory());
     printf("\n[STATS]\n");
     profiler::LogStats(profiler::GetStatsTable());
+    printf("\n[CALL TREE]\n");
+    profiler::LogStatsTree(profiler::GetCallTree());
     return 0;
 }
@@ -0,0 +1,223 @@
+#include <cstdio>
+#include <chrono>
+#include <vector>
+#include <algorithm>
+#include <thread>
+
+#include "../ProfilerLib/profilerlib.hpp"
+
+#ifndef _WIN32
+#include <dlfcn.h>
+#include "../ProfilerLib/profilerlib_elf.hpp"
+#endif
+
+#ifdef _MSC_VER
+#define NOINLINE __declspec(noinline)
+#else
+#define NOINLINE __attribute__((noinline))
+#endif
+
+constexpr int FRAME_COUNT = 50;
+constexpr int CALLS_PER_FRAME = 1'000'000;
+
+volatile int gSink = 0;
+
+NOINLINE void leaf() {
+    gSink = gSink + 1;
+}
+
+NOINLINE void branch(int n) {
+    for (int i = 0; i < n; ++i)
+        leaf();
+}
+
+NOINLINE void workload(int calls) {
+    // ~ 'calls' instrumented calls (1 branch every 4 leaves)
+    for (int i = 0; i < calls / 5; ++i)
+        branch(4);
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+using Clock = std::chrono::steady_clock;
+
+struct BenchResult {
+    double frameAvgUs = 0;
+    double frameMaxUs = 0;
+    double frameEndAvgUs = 0;
+    double frameEndMaxUs = 0;
+};
+
+static double elapsedUs(Clock::time_point beg, Clock::time_point end) {
+    return std::chrono::duration<double, std::micro>(end - beg).count();
+}
+
+static BenchResult runFrames(bool profiled) {
+    BenchResult res{};
+    if (profiled) profiler::Enable();
+    for (int f = 0; f < FRAME_COUNT; ++f) {
+        auto frameBeg = Clock::now();
+        profiler::FrameStart();
+        workload(CALLS_PER_FRAME);
+        auto endBeg = Clock::now();
+        profiler::FrameEnd();
+        auto frameEnd = Clock::now();
+        double frameUs = elapsedUs(frameBeg, frameEnd);
+        double endUs = elapsedUs(endBeg, frameEnd);
+        res.frameAvgUs += frameUs / FRAME_COUNT;
+        res.frameEndAvgUs += endUs / FRAME_COUNT;
+        res.frameMaxUs = std::max(res.frameMaxUs, frameUs);
+        res.frameEndMaxUs = std::max(res.frameEndMaxUs, endUs);
+    }
+    if (profiled) profiler::Disable();
+    profiler::ClearStats();
+    return res;
+}
+
+static void printResult(const char* name, const BenchResult& res, const BenchResult& baseline) {
+    double overheadNs = (res.frameAvgUs - baseline.frameAvgUs) * 1'000.0 / CALLS_PER_FRAME;
+    printf(
+        "%-24s | Frame avg: %10.1f (us) max: %10.1f (us) | FrameEnd avg: %10.1f (us) max: %10.1f (us) | Per-call: %6.2f (ns)\n",
+        name,
+        res.frameAvgUs,
+        res.frameMaxUs,
+        res.frameEndAvgUs,
+        res.frameEndMaxUs,
+        overheadNs
+    );
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+static void benchAggregation() {
+    printf("\n[AGGREGATION] %d frames, %d calls per frame\n", FRAME_COUNT, CALLS_PER_FRAME);
+    profiler::SetFrameHistoryCapacity(2 * CALLS_PER_FRAME + 1024);
+    BenchResult baseline = runFrames(false);
+    printResult("Disabled", baseline, baseline);
+    profiler::SetAggregationMode(profiler::AggregationMode::Replay);
+    printResult("Replay", runFrames(true), baseline);
+    profiler::SetAggregationThreads(std::max(std::thread::hardware_concurrency(), 1u));
+    printResult("Replay (all cores)", runFrames(true), baseline);
+    profiler::SetAggregationThreads(1);
+    profiler::SetAggregationMode(profiler::AggregationMode::Online);
+    printResult("Online", runFrames(true), baseline);
+    profiler::SetAggregationMode(profiler::AggregationMode::Background);
+    printResult("Background", runFrames(true), baseline);
+    printf("%-24s | Dropped: %zu frame(s) (collector a whole queue behind)\n", "", profiler::GetDroppedFrames());
+    profiler::SetAggregationMode(profiler::AggregationMode::Replay);
+}
+
+static void benchCapture() {
+    printf("\n[CAPTURE] %d frames, %d calls per frame\n", FRAME_COUNT, CALLS_PER_FRAME);
+    BenchResult baseline = runFrames(false);
+    printResult("Disabled", baseline, baseline);
+    profiler::SetCaptureMode(profiler::CaptureMode::History);
+    printResult("History", runFrames(true), baseline);
+    profiler::SetCaptureMode(profiler::CaptureMode::Stats);
+    printResult("Stats", runFrames(true), baseline);
+    profiler::SetCaptureMode(profiler::CaptureMode::Both);
+    printResult("Both", runFrames(true), baseline);
+}
+
+// Lazy: one platform lookup per address. Eager: symbol table load, then one binary search per address.
+// Each run loads a generated module of 1k / 10k / 100k function symbols and looks up every one of them once.
+#ifdef BENCH_SYMBOL_MODULES
+static void benchSymbolLoad() {
+    printf("\n[SYMBOL LOAD] Generated modules of 1k / 10k / 100k function symbols\n");
+    profiler::FuncInfo info{};
+    for (const char* path : { BENCH_SYMBOL_MODULES }) {
+        void* module = dlopen(path, RTLD_NOW | RTLD_LOCAL);
+        if (module == nullptr) {
+            printf("Failed to load '%s': %s\n", path, dlerror());
+            continue;
+        }
+        std::vector<profiler::FuncID> funcs;
+        char name[32];
+        for (;;) {
+            snprintf(name, sizeof(name), "bench_symbol_%zu", funcs.size());
+            void* func = dlsym(module, name);
+            if (func == nullptr) break;
+            funcs.push_back(reinterpret_cast<profiler::FuncID>(func));
+        }
+        std::vector<profiler::__SymbolEntry> entries;
+        profiler::__EnumerateSymbols(entries); // Warms up the symbol files for both modes
+
+        auto lazyBeg = Clock::now();
+        for (profiler::FuncID func : funcs)
+            profiler::__GetFuncInfo(func, info);
+        double lazyUs = elapsedUs(lazyBeg, Clock::now());
+
+        profiler::SetSymbolLoad(profiler::SymbolLoad::Lazy);
+        auto loadBeg = Clock::now();
+        profiler::SetSymbolLoad(profiler::SymbolLoad::Eager);
+        double loadUs = elapsedUs(loadBeg, Clock::now());
+        auto eagerBeg = Clock::now();
+        for (profiler::FuncID func : funcs)
+            profiler::__FindSymbolEntry(func, info);
+        double eagerUs = elapsedUs(eagerBeg, Clock::now());
+        profiler::SetSymbolLoad(profiler::SymbolLoad::Lazy);
+
+        printf("%-24s | Symbols: %7zu (%7zu loaded) | Lazy: %12.1f (us) | Eager: %12.1f (us) (load: %10.1f (us) + lookups: %10.1f (us))\n",
+            "Lazy vs Eager", funcs.size(), entries.size(), lazyUs, loadUs + eagerUs, loadUs, eagerUs);
+        dlclose(module);
+    }
+}
+#else
+static void benchSymbolLoad() {
+    printf("\n[SYMBOL LOAD] Skipped: the generated symbol modules are only built for ELF targets\n");
+}
+#endif
+
+#ifndef _WIN32
+static void benchSymbolizer() {
+    std::vector<profiler::FuncID> funcs;
+    profiler::elf::EnumerateFunctions(funcs);
+    printf("\n[SYMBOLIZER] %zu function symbols in the loaded modules\n", funcs.size());
+
+    // ELF / DWARF: first lookup maps the file and parses the line tables
+    profiler::FuncInfo info{};
+    auto coldBeg = Clock::now();
+    profiler::elf::Resolve(funcs.empty() ? nullptr : funcs[0], info);
+    double coldUs = elapsedUs(coldBeg, Clock::now());
+
+    size_t elfResolved = 0;
+    size_t elfWithLine = 0;
+    auto elfBeg = Clock::now();
+    for (profiler::FuncID func : funcs) {
+        if (profiler::elf::Resolve(func, info)) {
+            ++elfResolved;
+            elfWithLine += info.fileLine != 0;
+        }
+    }
+    double elfUs = elapsedUs(elfBeg, Clock::now());
+
+    // 'dladdr': exported symbols only, no line info
+    size_t dlResolved = 0;
+    char funcName[1024];
+    auto dlBeg = Clock::now();
+    for (profiler::FuncID func : funcs) {
+        Dl_info dlInfo{};
+        if (dladdr(func, &dlInfo) && dlInfo.dli_sname != nullptr) {
+            profiler::elf::Demangle(dlInfo.dli_sname, funcName, sizeof(funcName));
+            ++dlResolved;
+        }
+    }
+    double dlUs = elapsedUs(dlBeg, Clock::now());
+
+    printf("%-24s | Resolved: %8zu (with line: %8zu) | %12.0f (symbols/s) | First lookup: %10.1f (us)\n",
+        "ELF / DWARF", elfResolved, elfWithLine, funcs.size() / (elfUs / 1'000'000.0), coldUs);
+    printf("%-24s | Resolved: %8zu (with line: %8d) | %12.0f (symbols/s)\n",
+        "dladdr", dlResolved, 0, funcs.size() / (dlUs / 1'000'000.0));
+}
+#endif
+
+int main(int argc, char* argv[]) {
+    profiler::SetClockMode(profiler::ClockMode::RDTSC);
+    benchAggregation();
+    benchCapture();
+#ifndef _WIN32
+    benchSymbolizer();
+#endif
+    benchSymbolLoad(); // Last: the generated modules stay listed once unloaded
+    return 0;
+}
@@ -0,0 +1,21 @@
+// Module of BENCH_SYMBOL_COUNT function symbols, for the symbol load benchmark (see 'benchSymbolLoad').
+// Generated by the assembler (one 'ret' each): compiling that many C++ functions would take minutes.
+#define BENCH_STR_(x) #x
+#define BENCH_STR(x) BENCH_STR_(x)
+
+asm(
+	".text\n"
+	".altmacro\n"
+	".macro bench_symbol n\n"
+	".globl bench_symbol_\\n\n"
+	".type bench_symbol_\\n, @function\n"
+	"bench_symbol_\\n: ret\n"
+	".size bench_symbol_\\n, .-bench_symbol_\\n\n"
+	".endm\n"
+	".set bench_index, 0\n"
+	".rept " BENCH_STR(BENCH_SYMBOL_COUNT) "\n"
+	"bench_symbol %bench_index\n"
+	".set bench_index, bench_index + 1\n"
+	".endr\n"
+	".noaltmacro\n"
+);
@@ -1,46 +1,72 @@
+#include <atomic>
+#include <barrier>
+#include <cstdio>
 #include <iostream>
+#include <string>
 #include <thread>
-#include <ppl.h>
+#include <vector>
 
 #include "main_profiled.hpp"
-#include "..\ProfilerLib\profilerlib.hpp"
+#include "../ProfilerLib/profilerlib.hpp"
+
+constexpr int FRAME_COUNT = 3;
 
 int main(int argc, char* argv[]) {
     std::cout << "Main: " << std::this_thread::get_id() << "\n";
+    profiler::SetThreadName("main");
 
     //////////////////////////////////////////////////
-    {
-        profiler::Enable();
+    // Workers stay alive across frames. They never call FrameStart / FrameEnd: their frames follow
+    // the main thread's (each one is sealed on the worker's first event after the main FrameStart)
+    std::barrier go(THREAD_COUNT + 1), done(THREAD_COUNT + 1);
+    std::atomic<bool> stop = false;
+    profiler::TimeStamp beg{};
+    std::vector<std::thread> threads;
+    profiler::Enable();
+    for (int i = 0; i < THREAD_COUNT; ++i) {
+        threads.push_back(std::thread([&, i]() {
+            profiler::SetThreadName(("worker " + std::to_string(i)).c_str());
+            for (;;) {
+                go.arrive_and_wait();
+                if (stop) break;
+                yuppie(beg, i);
+                done.arrive_and_wait();
+            }
+        }));
+    }
+
+    //////////////////////////////////////////////////
+    for (int frame = 0; frame < FRAME_COUNT; ++frame) {
         profiler::FrameStart();
-        profiler::TimeStamp beg = profiler::Now();
-        // ////////////////////////
-        // std::vector<std::thread> threads;
-        // for (int i = 0; i < THREAD_COUNT; ++i)
-        //     threads.push_back(std::thread(yuppie, beg, i));
-        // for (int i = 0; i < THREAD_COUNT; ++i)
-        //     threads[i].join();
-        ////////////////////////
-        concurrency::parallel_for(0, THREAD_COUNT, [&beg](size_t index) {
-            yuppie(beg, index);
-        }, concurrency::static_partitioner());
-        ////////////////////////
+        beg = profiler::Now();
+        go.arrive_and_wait();
+        done.arrive_and_wait();
         profiler::FrameEnd();
-        profiler::Disable();
+
+        std::cout << "[FRAME " << frame << "]\n";
+        for (int i = 0; i < THREAD_COUNT; ++i) {
+            std::cout << i << ": " << gResults[i].str() << "\n";
+            gResults[i].str("");
+        }
     }
-    
-    //////////////////////////////////////////////////
-    // profiler::LogHistoryCompact(profiler::GetFrameHistory());
-    // printf("\n\n");
-    // profiler::LogStatsCompact(profiler::GetStatsTable());
-    // printf("\n\n");
-    
+
+    // Exiting seals the workers' last frame (no event of theirs follows it)
+    stop = true;
+    go.arrive_and_wait();
+    for (std::thread& thread : threads)
+        thread.join();
+    profiler::Disable();
+
     //////////////////////////////////////////////////
-    for (int i = 0; i < THREAD_COUNT; ++i)
-        std::cout << i << ": " << gResults[i].str() << "\n";
     std::cout << "\n\n";
-    for (int i = 0; i < THREAD_COUNT; ++i)
-        profiler::LogHistoryCompact(gHistories[i]);
+    for (const profiler::ThreadInfo& thread : profiler::GetThreads()) {
+        std::cout << "[THREAD " << thread.index << "] " << thread.name << " (" << thread.osId << ")\n";
+        profiler::FrameHistory history;
+        if (profiler::GetThreadFrameHistory(thread.index, history))
+            profiler::LogHistoryCompact(history);
+    }
+    std::cout << "\n\n[ALL THREADS]\n";
+    profiler::LogStatsCompact(profiler::GetMergedStatsTable());
     std::cout << "\n\n";
-
     return 0;
 }
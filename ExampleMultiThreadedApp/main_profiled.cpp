@@ -4,7 +4,6 @@
 #include <random>
 
 std::stringstream gResults[THREAD_COUNT] = { {} };
-profiler::FrameHistory gHistories[THREAD_COUNT] = { {} };
 
 int fakeload(int load) {
     int acc = 1;
@@ -27,7 +26,6 @@ int yuppie(profiler::TimeStamp refBeg, size_t tIndex) {
     profiler::DeltaUs deltaBeg = profiler::ComputeDelta(refBeg, beg);
     profiler::DeltaUs deltaEnd = profiler::ComputeDelta(refBeg, end);
     /////////////////////////////
-    gHistories[tIndex] = profiler::FrameHistory(profiler::GetFrameHistory());
     gResults[tIndex]
         << std::this_thread::get_id()
         << " [" << deltaBeg << ", " << deltaEnd << "] "
@@ -1,10 +1,11 @@
 #pragma once
 
-#include "..\ProfilerLib\profilerlib.hpp"
+#include "../ProfilerLib/profilerlib.hpp"
+
+#include <sstream>
 
 constexpr int THREAD_COUNT = 4;
 extern std::stringstream gResults[THREAD_COUNT];
-extern profiler::FrameHistory gHistories[THREAD_COUNT];
 
 int yuppie(profiler::TimeStamp refBeg, size_t tIndex);
 int yuppie_complex();
@@ -1,33 +1,452 @@
 #include "profilerlib.hpp"
 
+#include <atomic>
+#include <cstdio>
+#include <mutex>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define PROFILER_X86
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <x86intrin.h>
+#include <cpuid.h>
+#endif
+#endif
+
 static bool gEnabled = false;
-thread_local profiler::InfoTable gInfoDatabase{};
+static size_t gFrameHistoryCapacity = profiler::FrameHistoryDefaultCapacity;
+static profiler::OverflowPolicy gFrameHistoryPolicy = profiler::OverflowPolicy::DropNewest;
+static profiler::AggregationMode gAggregationMode = profiler::AggregationMode::Replay;
+static profiler::CaptureMode gCaptureMode = profiler::CaptureMode::Both;
+static bool gCaptureHistory = true; // Derived from gCaptureMode and gAggregationMode
+static bool gAggregateOnline = false;
+static bool gAggregateReplay = true;
+static bool gAggregateBackground = false;
+static bool gCaptureCallTree = false;
+static size_t gWindowFrames = 0; // 0: no sliding window (see 'SetStatsWindow')
+static double gWindowSeconds = 0.0;
+static std::atomic<unsigned int> gWindowGeneration = 0; // Bumped by 'SetStatsWindow'
+static profiler::ClockMode gClockMode = profiler::ClockMode::Chrono;
+static double gClockNsPerTick = 1.0;
 thread_local profiler::StatsTable gStatsDatabase{};
+thread_local profiler::CallTree gCallTree{};
+
+// Sliding window: the current frame is aggregated densely, then sealed into a ring of sparse buckets
+struct WindowBucket {
+	profiler::TimeStamp end = 0;
+	std::vector<std::pair<profiler::FuncIndex, profiler::FuncStats>> stats{};
+};
+thread_local profiler::StatsTable gWindowFrame{};
+thread_local std::vector<profiler::FuncIndex> gWindowTouched{}; // Functions of 'gWindowFrame' with stats
+thread_local std::vector<WindowBucket> gWindowRing{};
+thread_local size_t gWindowHead = 0; // Next bucket to write
+thread_local size_t gWindowCount = 0;
+thread_local profiler::StatsTable gWindowStats{}; // Merged on demand (see 'GetWindowStatsTable')
+thread_local bool gWindowDirty = false;
+thread_local unsigned int gWindowThreadGeneration = 0; // Last window settings this thread's ring follows
 thread_local int gFrameHistoryIndex = 0;
-thread_local profiler::FrameHistory gFrameHistory[2] = { {} };
+thread_local profiler::FrameHistory gFrameHistory[2] = {
+	profiler::FrameHistory::Lazy(gFrameHistoryCapacity, gFrameHistoryPolicy),
+	profiler::FrameHistory::Lazy(gFrameHistoryCapacity, gFrameHistoryPolicy),
+};
+
+// Frame epochs: advanced by the frame thread (see 'FrameStart'), followed by every other thread
+constexpr unsigned int gNoEpoch = ~0u;
+static std::atomic<unsigned int> gFrameEpoch = 0;
+static std::atomic<bool> gFrameThreadClaimed = false;
+thread_local unsigned int gThreadEpoch = gNoEpoch; // Last epoch seen by this thread
+thread_local bool gFrameThread = false; // This thread advances the epochs
+thread_local bool gFrameManual = false; // This thread calls 'FrameStart' itself (epochs ignored)
+thread_local bool gThreadRetired = false; // Exiting, its buffers are gone (events are dropped)
 
 struct StackEntry {
-	profiler::FuncID func;
+	profiler::FuncIndex func;
 	profiler::TimeStamp start;
+	profiler::DeltaTicks children; // Inclusive time of the callees returned so far
+	profiler::CallNodeIndex node; // Call path (see 'SetCallTreeCapture')
+};
+thread_local std::vector<StackEntry> gStack{}; // Shadow stack (FrameEnd replay or hooks, see AggregationMode)
+struct FuncState {
+	unsigned int depth = 0; // Activations on 'gStack' (recursion)
+	unsigned int touched = 0; // Last 'gFrameSerial' it got stats in
+};
+thread_local std::vector<FuncState> gFuncStates{}; // Indexed by FuncIndex
+thread_local std::vector<profiler::FuncIndex> gStatsTouched{}; // Functions with new stats this frame (to publish)
+thread_local unsigned int gFrameSerial = 1;
+thread_local profiler::StatsTable gFrameStats{}; // Parallel replay output (reset after every frame)
+thread_local std::vector<profiler::FuncIndex> gFrameTouched{};
+thread_local bool gFrameSealed = false; // No event since the last '__EndFrame'
+
+//////////////////////////////////////////////////////////////////////////////
+// Thread registry (see 'GetThreads').
+// Threads register on their first event. Other threads only read what a thread publishes under
+// its lock: its last sealed frame (buffers are flipped under the lock) and a copy of its stats,
+// refreshed at every seal for the functions called during the frame.
+// On exit, a thread seals its frame and moves its final frame and stats into its entry, which
+// stays queryable.
+
+struct ThreadData {
+	std::mutex lock{};
+	profiler::ThreadInfo info{};
+	profiler::FrameHistory* histories = nullptr; // The owner's 'gFrameHistory', null once it exited
+	const int* historyIndex = nullptr;
+	profiler::FrameHistory retained{}; // Final frame, once it exited
+	profiler::FrameHistory collected{}; // Last frame aggregated by the collector (Background)
+	bool collecting = false; // Its last frame went to the collector
+	profiler::StatsTable stats{}; // Published copy (its own table once it exited)
+	unsigned int collectedSerial = 0; // Bumped when the collector publishes into 'stats'
+};
+
+static std::mutex gThreadsLock{};
+static auto& gThreads = *new std::vector<std::shared_ptr<ThreadData>>(); // Registration order
+thread_local ThreadData* gThread = nullptr;
+thread_local profiler::__CollectorChannel* gCollectorChannel = nullptr;
+thread_local profiler::StatsTable gCollectedStats{}; // Own stats, as published by the collector (see 'GetStatsTable')
+thread_local unsigned int gCollectedSerial = ~0u;
+thread_local profiler::FrameHistory gCollectedFrame{}; // Own last frame, as published by the collector (see 'GetFrameHistory')
+thread_local unsigned int gCollectedFrameSerial = ~0u;
+thread_local size_t gDroppedFrames = 0; // Frames the collector was too far behind to take
+
+#ifdef PROFILERLIB_STATIC
+// Linked statically, the inline / template functions the library calls resolve to the first copy
+// the linker sees, often the executable's instrumented one: hooks raised while the library runs
+// on this thread are ignored. (The shared library binds its own copies, see '-Bsymbolic')
+thread_local bool gInLibrary = false;
+
+struct LibraryScope {
+	bool outer = gInLibrary;
+	LibraryScope() { gInLibrary = true; }
+	~LibraryScope() { gInLibrary = outer; }
+};
+#define LIBRARY_SCOPE() LibraryScope libraryScope{}
+#define HOOK_SCOPE() if (gInLibrary) return; LibraryScope libraryScope{}
+#else
+#define LIBRARY_SCOPE()
+#define HOOK_SCOPE()
+#endif
+
+void profiler::__IgnoreThreadHooks() {
+#ifdef PROFILERLIB_STATIC
+	gInLibrary = true;
+#endif
+}
+
+static void __RetireThread();
+
+// Destroyed on thread exit, before the buffers it retires (see '__RegisterThread')
+struct ThreadGuard {
+	std::shared_ptr<ThreadData> data{};
+	~ThreadGuard() {
+		LIBRARY_SCOPE();
+		if (data != nullptr) __RetireThread();
+	}
 };
-thread_local std::vector<StackEntry> gStack{};
+thread_local ThreadGuard gThreadGuard{};
+
+//////////////////////////////////////////////////////////////////////////////
+
+// Direct-mapped per-thread cache in front of '__InternFuncID' (which locks)
+struct FuncIndexCacheEntry {
+	profiler::FuncID func;
+	profiler::FuncIndex index;
+};
+constexpr size_t gFuncIndexCacheSize = 4096; // power of 2
+thread_local FuncIndexCacheEntry gFuncIndexCache[gFuncIndexCacheSize] = {};
+
+static inline profiler::FuncIndex __InternFuncIDCached(profiler::FuncID func) {
+	auto& entry = gFuncIndexCache[((size_t)func >> 4) & (gFuncIndexCacheSize - 1)];
+	if (entry.func != func) [[unlikely]] {
+		entry.index = profiler::__InternFuncID(func);
+		entry.func = func;
+	}
+	return entry.index;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+static inline void __PushStack(profiler::FuncIndex func, profiler::TimeStamp start) {
+	profiler::CallNodeIndex node = profiler::CallTree::Root;
+	if (gCaptureCallTree)
+		node = gCallTree.child(gStack.empty() ? profiler::CallTree::Root : gStack.back().node, func);
+	gStack.push_back({ .func = func, .start = start, .children = 0, .node = node });
+	if (func >= gFuncStates.size()) [[unlikely]]
+		gFuncStates.resize(std::max<size_t>(func + 1, gFuncStates.size() * 2));
+	gFuncStates[func].depth++;
+}
+
+// Pops the innermost call and accounts for it (the stack must not be empty)
+static inline void __PopStack(profiler::TimeStamp end) {
+	const StackEntry top = gStack.back();
+	gStack.pop_back();
+	// Raw ticks: no conversion (nor precision loss) on the hot path
+	profiler::DeltaTicks delta = (profiler::DeltaTicks)(end - top.start);
+	profiler::DeltaTicks self = delta - top.children;
+	// Only the outermost activation of a recursion counts
+	FuncState& state = gFuncStates[top.func];
+	bool outermost = (--state.depth == 0);
+	if (state.touched != gFrameSerial) {
+		state.touched = gFrameSerial;
+		gStatsTouched.push_back(top.func);
+	}
+	gStatsDatabase.record(top.func, delta, self, outermost);
+	if (top.node != profiler::CallTree::Root) {
+		profiler::CallNode& node = gCallTree[top.node];
+		node.invocationCount++;
+		node.ticksTot += delta;
+		node.ticksSelfTot += self;
+	}
+	if (gWindowFrames != 0) {
+		profiler::FuncStats& frame = gWindowFrame[top.func];
+		if (frame.invocationCount == 0)
+			gWindowTouched.push_back(top.func);
+		frame.record(delta, self, outermost);
+	}
+	if (!gStack.empty())
+		gStack.back().children += delta;
+}
+
+static void __ClearWindow();
+
+// Drops the window of this thread when the settings changed since (disabled included)
+static void __FollowWindowGeneration() {
+	const unsigned int generation = gWindowGeneration.load(std::memory_order_relaxed);
+	if (generation == gWindowThreadGeneration) return;
+	gWindowThreadGeneration = generation;
+	__ClearWindow();
+}
+
+// Moves the current frame's stats into the window ring (overwriting the oldest bucket)
+static void __SealWindowFrame() {
+	if (gWindowFrames == 0) return;
+	if (gWindowRing.size() != gWindowFrames) {
+		gWindowRing.assign(gWindowFrames, WindowBucket{});
+		gWindowHead = 0;
+		gWindowCount = 0;
+	}
+	WindowBucket& bucket = gWindowRing[gWindowHead];
+	bucket.end = profiler::Now();
+	bucket.stats.clear();
+	for (profiler::FuncIndex func : gWindowTouched) {
+		bucket.stats.push_back({ func, gWindowFrame[func] });
+		gWindowFrame[func] = profiler::FuncStats{};
+	}
+	gWindowTouched.clear();
+	gWindowHead = (gWindowHead + 1) % gWindowRing.size();
+	gWindowCount = std::min(gWindowCount + 1, gWindowRing.size());
+	gWindowDirty = true;
+}
+
+static void __ClearWindow() {
+	gWindowFrame.clear();
+	gWindowTouched.clear();
+	gWindowRing.clear();
+	gWindowHead = 0;
+	gWindowCount = 0;
+	gWindowStats.clear();
+	gWindowDirty = false;
+}
+
+// Drops the calls still running (not accounted)
+static void __ClearStack() {
+	for (const StackEntry& e : gStack)
+		gFuncStates[e.func].depth--;
+	gStack.clear();
+}
+
+// Large frames only (see 'SetAggregationThreads'), same stats as the serial replay
+static bool __ReplayParallel(const profiler::FrameHistory& history) {
+	if (!profiler::__AggregateParallel(history, gFrameStats, gFrameTouched)) return false;
+	for (profiler::FuncIndex func : gFrameTouched) {
+		profiler::FuncStats& frame = gFrameStats[func];
+		profiler::LatencyHistogram& histogram = gFrameStats.histogram(func);
+		if (func >= gFuncStates.size())
+			gFuncStates.resize(std::max<size_t>(func + 1, gFuncStates.size() * 2));
+		if (gFuncStates[func].touched != gFrameSerial) {
+			gFuncStates[func].touched = gFrameSerial;
+			gStatsTouched.push_back(func);
+		}
+		gStatsDatabase[func].merge(frame);
+		gStatsDatabase.histogram(func).merge(histogram);
+		if (gWindowFrames != 0) {
+			profiler::FuncStats& window = gWindowFrame[func];
+			if (window.invocationCount == 0)
+				gWindowTouched.push_back(func);
+			window.merge(frame);
+		}
+		frame = profiler::FuncStats{};
+		histogram.clear();
+	}
+	gFrameTouched.clear();
+	return true;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+static void __RegisterThread() {
+	if (gThread != nullptr) return;
+	// Built before the guard, so that they outlive it (thread_locals die in reverse order)
+	(void)gFrameHistory[0];
+	(void)gStatsDatabase;
+	(void)gCallTree;
+	(void)gWindowFrame, (void)gWindowTouched, (void)gWindowRing, (void)gWindowStats;
+	(void)gStack, (void)gFuncStates, (void)gStatsTouched, (void)gFrameStats, (void)gFrameTouched;
+	auto data = std::make_shared<ThreadData>();
+	data->info.osId = profiler::__GetCurrentThreadOSID();
+	data->histories = gFrameHistory;
+	data->historyIndex = &gFrameHistoryIndex;
+	{
+		std::lock_guard<std::mutex> lock(gThreadsLock);
+		data->info.index = (profiler::ThreadIndex)gThreads.size();
+		gThreads.push_back(data);
+	}
+	gThreadGuard.data = data;
+	gThread = data.get();
+}
+
+// Copies the stats changed this frame to the published table
+static void __PublishStats(bool collecting) {
+	if (gThread != nullptr) {
+		std::lock_guard<std::mutex> lock(gThread->lock);
+		gThread->collecting = collecting;
+		for (profiler::FuncIndex func : gStatsTouched) {
+			gThread->stats[func] = gStatsDatabase[func];
+			gThread->stats.histogram(func) = gStatsDatabase.histogram(func);
+		}
+	}
+	gStatsTouched.clear();
+	gFrameSerial++;
+}
+
+static void __BeginFrame() {
+	std::unique_lock<std::mutex> lock;
+	if (gThread != nullptr)
+		lock = std::unique_lock<std::mutex>(gThread->lock);
+	gFrameHistoryIndex = (gFrameHistoryIndex + 1) % 2;
+	gFrameSealed = false;
+	auto& history = gFrameHistory[gFrameHistoryIndex];
+	if (!gCaptureHistory) {
+		// Release the buffer, if any (CaptureMode::Stats keeps memory constant)
+		if (history.capacity() != 0)
+			history = profiler::FrameHistory::Lazy(gFrameHistoryCapacity, gFrameHistoryPolicy);
+		return;
+	}
+	if (history.capacity() != gFrameHistoryCapacity || history.policy() != gFrameHistoryPolicy)
+		history.reserve(gFrameHistoryCapacity, gFrameHistoryPolicy);
+	history.clear();
+}
+
+static void __EndFrame() {
+	__FollowWindowGeneration(); // Before the replay accounts for the frame
+	// Background: replayed here as well while the collector is stopped (see '__SetCollectorThread')
+	const bool collect = gAggregateBackground && profiler::__IsCollectorRunning();
+	// Online: stats are already up to date (open calls stay on the shadow stack)
+	if (gAggregateReplay || (gAggregateBackground && !collect)) {
+		if (gThread != nullptr) {
+			// Back from the collector (drained once stopped): its stats go on from here
+			std::lock_guard<std::mutex> lock(gThread->lock);
+			if (gThread->collecting)
+				gStatsDatabase = gThread->stats;
+		}
+		__ClearStack();
+		const auto& history = gFrameHistory[gFrameHistoryIndex];
+		// The call tree (per call path) is only built serially
+		if (gCaptureCallTree || !__ReplayParallel(history)) {
+			for (auto it = history.begin(); it != history.end(); ++it) {
+				const auto& e = *it;
+				if (e.id != profiler::EmptyFuncID) {
+					__PushStack(it.funcIndex(), e.time);
+				}
+				else {
+					if (gStack.size() == 0) continue;
+					__PopStack(e.time);
+				}
+			}
+		}
+	}
+	else if (collect) {
+		if (gCollectorChannel == nullptr) {
+			__RegisterThread(); // 'FrameEnd' may come before any event
+			gCollectorChannel = profiler::__OpenCollectorChannel(gThread->info.index);
+		}
+		// Back from aggregating its frames itself (or first frame): the collector goes on from its stats
+		if (!gThread->collecting)
+			profiler::__SeedCollectedStats(gCollectorChannel, gStatsDatabase);
+		if (!profiler::__SubmitFrame(gCollectorChannel, gFrameHistory[gFrameHistoryIndex]))
+			gDroppedFrames++;
+	}
+	__SealWindowFrame();
+	__PublishStats(collect);
+	gFrameSealed = true;
+}
+
+static void __RetireThread() {
+	// Threads following the epochs only seal on their next event, which will never come
+	if (!gFrameSealed) __EndFrame();
+	// Before locking: closing may drain the channel here, which publishes to this thread
+	if (gCollectorChannel != nullptr) {
+		profiler::__CloseCollectorChannel(gCollectorChannel);
+		gCollectorChannel = nullptr;
+	}
+	std::lock_guard<std::mutex> lock(gThread->lock);
+	gThread->retained = std::move(gFrameHistory[gFrameHistoryIndex]);
+	if (!gThread->collecting) // The collector keeps publishing its own
+		gThread->stats = std::move(gStatsDatabase);
+	gThread->histories = nullptr;
+	gThread->historyIndex = nullptr;
+	gThread->info.exited = true;
+	gThread = nullptr;
+	// Instrumented destructors of the thread_locals still to die must not record anything
+	gThreadRetired = true;
+	gThreadEpoch = gNoEpoch; // Sends every event to '__FollowFrameEpoch'
+}
+
+// Threads that never call 'FrameStart' follow the frame thread: their first event of a new
+// epoch seals their frame (as 'FrameEnd' + 'FrameStart' would)
+// False if the event must be dropped
+static bool __FollowFrameEpoch(unsigned int epoch) {
+	if (gThreadRetired) return false;
+	const bool first = (gThreadEpoch == gNoEpoch);
+	gThreadEpoch = epoch;
+	if (first) __RegisterThread();
+	if (gFrameManual || first) return true;
+	__EndFrame();
+	__BeginFrame();
+	return true;
+}
+
+static inline bool __CheckFrameEpoch() {
+	unsigned int epoch = gFrameEpoch.load(std::memory_order_relaxed);
+	if (epoch != gThreadEpoch) [[unlikely]]
+		return __FollowFrameEpoch(epoch);
+	return true;
+}
 
 //////////////////////////////////////////////////////////////////////////////
 
 void PEnter(profiler::FuncID func) {
+	HOOK_SCOPE();
 	if (!gEnabled) return;
-	gFrameHistory[gFrameHistoryIndex].push_back({
-		.id = func,
-		.time = profiler::Now(),
-	});
+	if (!__CheckFrameEpoch()) return;
+	profiler::TimeStamp now = profiler::Now();
+	profiler::FuncIndex index = __InternFuncIDCached(func);
+	if (gCaptureHistory)
+		gFrameHistory[gFrameHistoryIndex].pushEnter(index, now);
+	if (gAggregateOnline)
+		__PushStack(index, now);
 }
 
-void PExit(profiler::FuncID func /* should be NULL */) {
+void PExit([[maybe_unused]] profiler::FuncID func /* should be NULL */) {
+	HOOK_SCOPE();
 	if (!gEnabled) return;
-	gFrameHistory[gFrameHistoryIndex].push_back({
-		.id = profiler::EmptyFuncID,
-		.time = profiler::Now(),
-	});
+	if (!__CheckFrameEpoch()) return;
+	profiler::TimeStamp now = profiler::Now();
+	if (gCaptureHistory)
+		gFrameHistory[gFrameHistoryIndex].pushExit(now);
+	if (gAggregateOnline) {
+		if (gStack.empty()) return; // Entered before switching to 'Online'
+		__PopStack(now);
+	}
 }
 
 //////////////////////////////////////////////////////////////////////////////
@@ -46,126 +465,440 @@ bool profiler::Disable() {
 
 void profiler::FrameStart() {
 	if (!gEnabled) return;
-	gFrameHistoryIndex = (gFrameHistoryIndex + 1) % 2;
-	gFrameHistory[gFrameHistoryIndex].clear();
+	LIBRARY_SCOPE();
+	gFrameManual = true;
+	__RegisterThread();
+	__BeginFrame();
+	// The first thread calling 'FrameStart' drives the frames of every other thread
+	if (!gFrameThread) {
+		bool claimed = false;
+		gFrameThread = gFrameThreadClaimed.compare_exchange_strong(claimed, true, std::memory_order_relaxed);
+	}
+	if (gFrameThread)
+		gThreadEpoch = gFrameEpoch.fetch_add(1, std::memory_order_relaxed) + 1;
 }
 
 void profiler::FrameEnd() {
 	if (!gEnabled) return;
-	gStack.clear();
-	for (const auto& e : gFrameHistory[gFrameHistoryIndex]) {
-		if (e.id != EmptyFuncID) {
-			gStack.push_back({ .func = e.id, .start = e.time });
-		}
-		else {
-			if (gStack.size() == 0) continue;
-			FuncID id = gStack[gStack.size() - 1].func;
-			TimeStamp beg = gStack[gStack.size() - 1].start;
-			TimeStamp end = e.time;
-			DeltaUs delta = ComputeDelta(beg, end);
-			gStack.pop_back();
-			if (!gStatsDatabase.contains(id))
-				gStatsDatabase.insert({ id, {} });
-			profiler::FuncStats& entry = gStatsDatabase.at(id);
-			entry.invocationCount++;
-			entry.usMin = std::min(entry.usMin, delta);
-			entry.usMax = std::max(entry.usMax, delta);
-			entry.usTot += delta;
-			entry.usAvg = entry.usTot / entry.invocationCount;
-		}
-	}
+	LIBRARY_SCOPE();
+	__EndFrame();
 }
 
 void profiler::ClearStats() {
+	LIBRARY_SCOPE();
 	gStatsDatabase.clear();
-}
-
-const profiler::FuncInfo& profiler::GetFuncInfo(FuncID func) {
-	if (!gInfoDatabase.contains(func)) {
-		FuncInfo info{};
-		__GetFuncInfo(func, info);
-		gInfoDatabase.insert({ func, info });
+	gCallTree.clear();
+	__ClearWindow();
+	gStatsTouched.clear();
+	gFrameSerial++; // Functions already touched this frame must be published again
+	if (gThread != nullptr) {
+		std::lock_guard<std::mutex> lock(gThread->lock);
+		gThread->stats.clear();
+		gThread->collectedSerial++;
 	}
-	return gInfoDatabase.at(func);
+	if (gCollectorChannel != nullptr)
+		profiler::__ClearCollectedStats(gCollectorChannel);
+	// Calls still running would point at dropped nodes
+	for (StackEntry& e : gStack)
+		e.node = CallTree::Root;
 }
 
-const profiler::InfoTable& profiler::GetInfoTable() {
-	return gInfoDatabase;
+// Background: the collector computes the stats, this thread only gets a copy of what it published
+static const profiler::StatsTable& __OwnStatsTable() {
+	if (gThread == nullptr) return gStatsDatabase;
+	std::lock_guard<std::mutex> lock(gThread->lock);
+	if (!gThread->collecting) return gStatsDatabase;
+	if (gCollectedSerial != gThread->collectedSerial) {
+		gCollectedStats = gThread->stats;
+		gCollectedSerial = gThread->collectedSerial;
+	}
+	return gCollectedStats;
 }
 
 const profiler::FuncStats& profiler::GetFuncStats(FuncID func) {
-	return gStatsDatabase.at(func);
+	LIBRARY_SCOPE();
+	return __OwnStatsTable().at(func);
 }
 
 const profiler::StatsTable& profiler::GetStatsTable() {
-	return gStatsDatabase;
+	LIBRARY_SCOPE();
+	return __OwnStatsTable();
+}
+
+void profiler::SetStatsWindow(size_t frames, double seconds /*= 0.0*/) {
+	LIBRARY_SCOPE();
+	// Other threads reset their ring on their next 'FrameEnd'
+	gWindowFrames = frames;
+	gWindowSeconds = seconds;
+	gWindowGeneration.fetch_add(1, std::memory_order_relaxed);
+	__FollowWindowGeneration();
+}
+
+const profiler::StatsTable& profiler::GetWindowStatsTable() {
+	LIBRARY_SCOPE();
+	__FollowWindowGeneration();
+	// Only re-merged when a frame was sealed since (or always, when bounded in time)
+	if (!gWindowDirty && gWindowSeconds <= 0.0) return gWindowStats;
+	gWindowStats.clear();
+	const TimeStamp now = Now();
+	const TimeStamp span = (TimeStamp)(gWindowSeconds * 1'000'000'000.0 / gClockNsPerTick);
+	for (size_t i = 0; i < gWindowCount; ++i) {
+		const WindowBucket& bucket = gWindowRing[(gWindowHead + gWindowRing.size() - 1 - i) % gWindowRing.size()];
+		if (gWindowSeconds > 0.0 && now - bucket.end > span) break; // Older ones are even older
+		for (const auto& [func, stats] : bucket.stats)
+			gWindowStats[func].merge(stats);
+	}
+	gWindowDirty = false;
+	return gWindowStats;
+}
+
+void profiler::SetThreadName(const char* name) {
+	LIBRARY_SCOPE();
+	__RegisterThread();
+	std::lock_guard<std::mutex> lock(gThread->lock);
+	gThread->info.name = (name != nullptr) ? name : "";
+}
+
+static std::shared_ptr<ThreadData> __FindThread(profiler::ThreadIndex thread) {
+	std::lock_guard<std::mutex> lock(gThreadsLock);
+	return thread < gThreads.size() ? gThreads[thread] : nullptr;
+}
+
+std::vector<profiler::ThreadInfo> profiler::GetThreads() {
+	std::vector<std::shared_ptr<ThreadData>> threads;
+	{
+		std::lock_guard<std::mutex> lock(gThreadsLock);
+		threads = gThreads;
+	}
+	std::vector<ThreadInfo> infos;
+	for (const auto& data : threads) {
+		std::lock_guard<std::mutex> lock(data->lock);
+		infos.push_back(data->info);
+	}
+	return infos;
+}
+
+bool profiler::GetThreadFrameHistory(ThreadIndex thread, FrameHistory& out) {
+	std::shared_ptr<ThreadData> data = __FindThread(thread);
+	if (data == nullptr) return false;
+	std::lock_guard<std::mutex> lock(data->lock);
+	if (data->collecting)
+		out = data->collected;
+	else if (data->histories == nullptr)
+		out = data->retained;
+	else
+		out = data->histories[((*data->historyIndex - 1) + 2) % 2]; // As 'GetFrameHistory'
+	return true;
+}
+
+bool profiler::GetThreadStatsTable(ThreadIndex thread, StatsTable& out) {
+	std::shared_ptr<ThreadData> data = __FindThread(thread);
+	if (data == nullptr) return false;
+	std::lock_guard<std::mutex> lock(data->lock);
+	out = data->stats;
+	return true;
+}
+
+profiler::StatsTable profiler::GetMergedStatsTable() {
+	std::vector<std::shared_ptr<ThreadData>> threads;
+	{
+		std::lock_guard<std::mutex> lock(gThreadsLock);
+		threads = gThreads;
+	}
+	StatsTable merged{};
+	for (const auto& data : threads) {
+		std::lock_guard<std::mutex> lock(data->lock);
+		merged.merge(data->stats);
+	}
+	return merged;
+}
+
+void profiler::__PublishCollectedFrame(ThreadIndex thread, const StatsTable& stats, const std::vector<FuncIndex>& touched, FrameHistory& frame) {
+	std::shared_ptr<ThreadData> data = __FindThread(thread);
+	if (data == nullptr) return;
+	std::lock_guard<std::mutex> lock(data->lock);
+	for (FuncIndex func : touched) {
+		data->stats[func] = *stats.find(func);
+		data->stats.histogram(func) = *stats.findHistogram(func);
+	}
+	data->collectedSerial++;
+	std::swap(data->collected, frame);
+}
+
+const profiler::CallTree& profiler::GetCallTree() {
+	return gCallTree;
+}
+
+void profiler::SetCallTreeCapture(bool enabled) {
+	gCaptureCallTree = enabled;
+}
+
+bool profiler::GetCallTreeCapture() {
+	return gCaptureCallTree;
+}
+
+static void __UpdateModes() {
+	gCaptureHistory = (gCaptureMode != profiler::CaptureMode::Stats);
+	gAggregateOnline = (gCaptureMode == profiler::CaptureMode::Stats)
+		|| (gCaptureMode == profiler::CaptureMode::Both && gAggregationMode == profiler::AggregationMode::Online);
+	gAggregateReplay = (gCaptureMode == profiler::CaptureMode::Both && gAggregationMode == profiler::AggregationMode::Replay);
+	gAggregateBackground = (gCaptureMode == profiler::CaptureMode::Both && gAggregationMode == profiler::AggregationMode::Background);
+	profiler::__SetCollectorThread(gAggregateBackground);
+	// The caller's shadow stack is reset, other threads' ones only hold calls still running
+	__ClearStack();
+}
+
+void profiler::SetAggregationMode(AggregationMode mode) {
+	LIBRARY_SCOPE();
+	gAggregationMode = mode;
+	__UpdateModes();
+}
+
+profiler::AggregationMode profiler::GetAggregationMode() {
+	return gAggregationMode;
+}
+
+void profiler::SetCaptureMode(CaptureMode mode) {
+	LIBRARY_SCOPE();
+	// Each thread releases its history buffers on its next 'FrameStart' (when switching to 'Stats')
+	gCaptureMode = mode;
+	__UpdateModes();
+}
+
+profiler::CaptureMode profiler::GetCaptureMode() {
+	return gCaptureMode;
 }
 
 const profiler::FrameHistory& profiler::GetFrameHistory() {
-	return gFrameHistory[((gFrameHistoryIndex - 1) + 2) % 2];
+	LIBRARY_SCOPE();
+	const FrameHistory& history = gFrameHistory[((gFrameHistoryIndex - 1) + 2) % 2];
+	if (gThread == nullptr) return history;
+	// Background: the frame went to the collector, this thread only gets a copy of the last one it aggregated
+	std::lock_guard<std::mutex> lock(gThread->lock);
+	if (!gThread->collecting) return history;
+	if (gCollectedFrameSerial != gThread->collectedSerial) {
+		gCollectedFrame = gThread->collected;
+		gCollectedFrameSerial = gThread->collectedSerial;
+	}
+	return gCollectedFrame;
+}
+
+size_t profiler::GetDroppedFrames() {
+	return gDroppedFrames;
+}
+
+void profiler::SetFrameHistoryCapacity(size_t capacity, OverflowPolicy policy /*= OverflowPolicy::DropNewest*/) {
+	LIBRARY_SCOPE();
+	// Other threads pick up the new values on their next 'FrameStart'
+	std::unique_lock<std::mutex> lock;
+	if (gThread != nullptr)
+		lock = std::unique_lock<std::mutex>(gThread->lock);
+	gFrameHistory[0].reserve(capacity, policy);
+	gFrameHistory[1].reserve(capacity, policy);
+	gFrameHistoryCapacity = gFrameHistory[0].capacity();
+	gFrameHistoryPolicy = policy;
 }
 
 //////////////////////////////////////////////////////////////////////////////
 
-inline profiler::TimeStamp profiler::Now() noexcept {
-	return std::chrono::high_resolution_clock::now();
+static inline profiler::TimeStamp __ReadChrono() noexcept {
+	auto now = std::chrono::steady_clock::now().time_since_epoch();
+	return (profiler::TimeStamp)std::chrono::duration_cast<std::chrono::nanoseconds>(now).count();
+}
+
+static bool __CpuSupportsTSC(profiler::ClockMode mode) {
+#ifdef PROFILER_X86
+	//////////////////////////////////////////////////////////////////////////////
+	// https://www.felixcloutier.com/x86/cpuid
+	// 1. Extended leaf 0x80000007, EDX[8]: Invariant TSC (constant rate, synced across cores)
+	// 2. Extended leaf 0x80000001, EDX[27]: 'rdtscp' available
+	unsigned int regs[4] = { 0 }; // eax, ebx, ecx, edx
+	auto cpuid = [&regs](unsigned int leaf) {
+#ifdef _MSC_VER
+		__cpuid((int*)regs, (int)leaf);
+#else
+		__cpuid(leaf, regs[0], regs[1], regs[2], regs[3]);
+#endif
+	};
+	cpuid(0x80000000);
+	unsigned int maxLeaf = regs[0];
+	if (maxLeaf < 0x80000007) return false;
+	cpuid(0x80000007);
+	if (!(regs[3] & (1u << 8))) return false;
+	if (mode == profiler::ClockMode::RDTSCP) {
+		cpuid(0x80000001);
+		if (!(regs[3] & (1u << 27))) return false;
+	}
+	return true;
+#else
+	return false;
+#endif
+}
+
+static double __CalibrateTSC() {
+#ifdef PROFILER_X86
+	//////////////////////////////////////////////////////////////////////////////
+	// Measure TSC ticks against 'steady_clock' over a short busy-wait (~20ms).
+	// Done once, the first time a TSC mode is selected.
+	static double nsPerTick = 0;
+	if (nsPerTick != 0) return nsPerTick;
+	profiler::TimeStamp chronoBeg = __ReadChrono();
+	profiler::TimeStamp tscBeg = __rdtsc();
+	profiler::TimeStamp chronoEnd = chronoBeg;
+	while (chronoEnd - chronoBeg < 20'000'000)
+		chronoEnd = __ReadChrono();
+	profiler::TimeStamp tscEnd = __rdtsc();
+	nsPerTick = (double)(chronoEnd - chronoBeg) / (double)(tscEnd - tscBeg);
+	return nsPerTick;
+#else
+	return 1.0;
+#endif
+}
+
+bool profiler::SetClockMode(ClockMode mode) {
+	// Timestamps from different modes can't be mixed: switch while disabled (or between sessions)
+	if (mode != ClockMode::Chrono && !__CpuSupportsTSC(mode)) {
+		gClockMode = ClockMode::Chrono;
+		gClockNsPerTick = 1.0;
+		return false;
+	}
+	gClockNsPerTick = (mode == ClockMode::Chrono) ? 1.0 : __CalibrateTSC();
+	gClockMode = mode;
+	return true;
+}
+
+profiler::ClockMode profiler::GetClockMode() {
+	return gClockMode;
+}
+
+double profiler::GetClockNsPerTick() {
+	return gClockNsPerTick;
+}
+
+profiler::TimeStamp profiler::Now() noexcept {
+	switch (gClockMode) {
+#ifdef PROFILER_X86
+	case ClockMode::RDTSC:
+		return __rdtsc();
+	case ClockMode::RDTSCP: {
+		unsigned int aux = 0;
+		return __rdtscp(&aux);
+	}
+#endif
+	default:
+		return __ReadChrono();
+	}
+}
+
+profiler::DeltaUs profiler::ComputeDelta(TimeStamp beg, TimeStamp end) noexcept {
+	// Ticks are converted only here (aggregation / display)
+	return (DeltaUs)((long long int)(end - beg) * gClockNsPerTick / 1'000.0);
+}
+
+profiler::DeltaNs profiler::ComputeDeltaNs(TimeStamp beg, TimeStamp end) noexcept {
+	return (DeltaNs)((long long int)(end - beg) * gClockNsPerTick);
 }
 
-inline profiler::DeltaUs profiler::ComputeDelta(TimeStamp beg, TimeStamp end) noexcept {
-	return (std::chrono::duration_cast<std::chrono::microseconds>(end - beg)).count();
+double profiler::TicksToNs(DeltaTicks ticks) noexcept {
+	return (double)ticks * gClockNsPerTick;
 }
 
 //////////////////////////////////////////////////////////////////////////////
 
-void profiler::LogStats(const StatsTable& stats) {
-	std::vector<std::pair<FuncID, FuncStats>> list(stats.begin(), stats.end());
+// Indices of the functions with stats, sorted by total time (descending)
+static std::vector<profiler::FuncIndex> __SortByTotalTime(const profiler::StatsTable& stats) {
+	std::vector<profiler::FuncIndex> list{};
+	for (auto it = stats.begin(); it != stats.end(); ++it)
+		list.push_back(it.index());
 	std::sort(list.begin(), list.end(),
-		[](const std::pair<FuncID, FuncStats>& a, const std::pair<FuncID, FuncStats>& b) {
-			return (a.second.usTot > b.second.usTot);
+		[&stats](profiler::FuncIndex a, profiler::FuncIndex b) {
+			return (stats.find(a)->ticksTot > stats.find(b)->ticksTot);
 		});
-	for (const auto& p : list) {
-		auto funcId = p.first;
-		const auto& data = p.second;
-		const auto& funcInfo = profiler::GetFuncInfo(funcId);
+	return list;
+}
+
+void profiler::LogStats(const StatsTable& stats) {
+	for (FuncIndex index : __SortByTotalTime(stats)) {
+		const auto& data = *stats.find(index);
+		const auto& funcInfo = profiler::GetFuncInfo(__GetFuncIDFromIndex(index));
+		const LatencyHistogram* histogram = stats.findHistogram(index);
+		auto percentile = [histogram](double p) { return histogram != nullptr ? histogram->percentile(p) : 0; };
 		printf(
-			"%-64.64s.%-4d | Max: %8lld (us) | Min: %8lld (us) | Avg: %8lld (us) | Tot: %8lld (us) | Count: %d\n",
+			"%-64.64s.%-4d | Max: %12.3f (us) | Min: %12.3f (us) | Avg: %12.3f (us) | P50: %12.3f (us) | P90: %12.3f (us) | P99: %12.3f (us) | P99.9: %12.3f (us) | Std: %12.3f (us) | CV: %6.3f | Tot: %12.3f (us) | Self: %12.3f (us) | Incl: %12.3f (us) | Count: %d\n",
 			funcInfo.funcName,
 			funcInfo.fileLine,
-			data.usMax,
-			data.usMin,
-			data.usAvg,
-			data.usTot,
+			TicksToNs(data.ticksMax) / 1'000.0,
+			TicksToNs(data.ticksMin) / 1'000.0,
+			TicksToNs(data.ticksAvg()) / 1'000.0,
+			TicksToNs(percentile(50.0)) / 1'000.0,
+			TicksToNs(percentile(90.0)) / 1'000.0,
+			TicksToNs(percentile(99.0)) / 1'000.0,
+			TicksToNs(percentile(99.9)) / 1'000.0,
+			data.ticksStddev() * GetClockNsPerTick() / 1'000.0,
+			data.cv(),
+			TicksToNs(data.ticksTot) / 1'000.0,
+			TicksToNs(data.ticksSelfTot) / 1'000.0,
+			TicksToNs(data.ticksCollapsedTot) / 1'000.0,
 			data.invocationCount
 		);
 	}
 }
 
 void profiler::LogStatsCompact(const StatsTable& stats) {
-	std::vector<std::pair<FuncID, FuncStats>> list(stats.begin(), stats.end());
-	std::sort(list.begin(), list.end(),
-		[](const std::pair<FuncID, FuncStats>& a, const std::pair<FuncID, FuncStats>& b) {
-			return (a.second.usTot > b.second.usTot);
-		});
-	for (const auto& p : list) {
-		auto funcId = p.first;
-		const auto& data = p.second;
-		const auto& funcInfo = profiler::GetFuncInfo(funcId);
+	for (FuncIndex index : __SortByTotalTime(stats)) {
+		const auto& data = *stats.find(index);
+		const auto& funcInfo = profiler::GetFuncInfo(__GetFuncIDFromIndex(index));
 		printf(
-			"%-32.32s.%-4d | Avg: %8lld (us) | Count: %d\n",
+			"%-32.32s.%-4d | Avg: %12.3f (us) | Count: %d\n",
 			funcInfo.funcName,
 			funcInfo.fileLine,
-			data.usAvg,
+			TicksToNs(data.ticksAvg()) / 1'000.0,
 			data.invocationCount
 		);
 	}
 }
 
+void profiler::LogStatsTree(const CallTree& tree) {
+	// Depth-first, siblings sorted by total time (descending)
+	auto children = [&tree](CallNodeIndex parent) {
+		std::vector<CallNodeIndex> list{};
+		for (CallNodeIndex child = tree[parent].firstChild; child != 0; child = tree[child].nextSibling)
+			list.push_back(child);
+		std::sort(list.begin(), list.end(), [&tree](CallNodeIndex a, CallNodeIndex b) {
+			return tree[a].ticksTot < tree[b].ticksTot; // Popped from the back
+		});
+		return list;
+	};
+	std::vector<std::pair<CallNodeIndex, unsigned int>> pending{}; // (node, depth)
+	for (CallNodeIndex child : children(CallTree::Root))
+		pending.push_back({ child, 0 });
+	while (!pending.empty()) {
+		auto [index, depth] = pending.back();
+		pending.pop_back();
+		const CallNode& node = tree[index];
+		const auto& funcInfo = profiler::GetFuncInfo(__GetFuncIDFromIndex(node.func));
+		printf(
+			"%*.s[+] %-s.%-3d | Tot: %12.3f (us) | Self: %12.3f (us) | Count: %d\n",
+			depth * 2,
+			"",
+			funcInfo.funcName,
+			funcInfo.fileLine,
+			TicksToNs(node.ticksTot) / 1'000.0,
+			TicksToNs(node.ticksSelfTot) / 1'000.0,
+			node.invocationCount
+		);
+		for (CallNodeIndex child : children(index))
+			pending.push_back({ child, depth + 1 });
+	}
+}
+
 void profiler::LogHistory(const FrameHistory& history) {
-	std::stack<int> callstack;
-	for (int i = 0; i < history.size(); ++i) {
-		const auto& e = history[i];
+	if (history.dropped() > 0)
+		printf("[!] %zu events dropped (history capacity: %zu)\n", history.dropped(), history.capacity());
+	std::stack<FrameHistoryEntry> callstack;
+	for (const auto& e : history) {
 		if (e.id != EmptyFuncID) {
-			callstack.push(i);
+			callstack.push(e);
 			const auto& funcInfo = profiler::GetFuncInfo(e.id);
 			printf(
 				"%*.s[+] %-s.%-3d\n",
@@ -176,15 +909,16 @@ void profiler::LogHistory(const FrameHistory& history) {
 			);
 		}
 		else {
-			const auto& startEv = history[callstack.top()];
+			if (callstack.empty()) continue; // Its enter has been dropped (OverflowPolicy::DropOldest)
+			const auto& startEv = callstack.top();
 			const auto& funcInfo = profiler::GetFuncInfo(startEv.id);
 			printf(
-				"%*.s[-] %-s.%03d, time: %llu (us)\n",
+				"%*.s[-] %-s.%03d, time: %.3f (us)\n",
 				(unsigned int)(callstack.size() - 1) * 2,
 				"",
 				funcInfo.funcName,
 				funcInfo.fileLine,
-				ComputeDelta(startEv.time, e.time)
+				TicksToNs((DeltaTicks)(e.time - startEv.time)) / 1'000.0
 			);
 			callstack.pop();
 		}
@@ -192,22 +926,22 @@ void profiler::LogHistory(const FrameHistory& history) {
 }
 
 void profiler::LogHistoryCompact(const FrameHistory& history) {
-	std::stack<int> callstack;
-	for (int i = 0; i < history.size(); ++i) {
-		const auto& e = history[i];
+	size_t depth = 0;
+	for (const auto& e : history) {
 		if (e.id != EmptyFuncID) {
-			callstack.push(i);
+			depth++;
 			const auto& funcInfo = profiler::GetFuncInfo(e.id);
 			printf(
 				"%*.s[+] %-s.%-3d\n",
-				(unsigned int)(callstack.size() - 1) * 2,
+				(unsigned int)(depth - 1) * 2,
 				"",
 				funcInfo.funcName,
 				funcInfo.fileLine
 			);
 		}
 		else {
-			callstack.pop();
+			if (depth == 0) continue; // Its enter has been dropped (OverflowPolicy::DropOldest)
+			depth--;
 		}
 	}
 }
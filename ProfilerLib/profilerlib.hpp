@@ -1,82 +1,600 @@
 #pragma once
 
+#if defined(PROFILERLIB_STATIC)
+#define DLLAPI
+#elif defined(_MSC_VER)
 #ifdef _LIB
 #define DLLAPI __declspec( dllexport )
 #else
 #define DLLAPI __declspec( dllimport )
 #endif
+#else
+#define DLLAPI __attribute__(( visibility("default") ))
+#endif
 
 #include <algorithm>
+#include <bit>
+#include <memory>
+#include <iterator>
 #include <vector>
 #include <stack>
 #include <unordered_map>
 #include <chrono>
+#include <cmath>
+#include <functional>
+#include <limits>
+#include <string>
 
 namespace profiler {
 	// Functions
 	using FuncID = void*;
 	constexpr FuncID EmptyFuncID = nullptr;
+	using FuncIndex = unsigned int; // Dense, process-wide, interned FuncID
 
 	// Time
-	using TimeStamp = std::chrono::high_resolution_clock::time_point;
+	using TimeStamp = unsigned long long int; // Raw ticks of the active ClockMode
 	using DeltaUs = long long int;
+	using DeltaNs = long long int;
+	using DeltaTicks = long long int; // Raw ticks of the active ClockMode (see 'TicksToNs')
+	// Aggregation
+	enum class AggregationMode {
+		Replay, // Stats are computed in 'FrameEnd' by replaying the frame's history
+		Online, // Stats are updated on every exit (shadow stack kept by the hooks), 'FrameEnd' is O(1)
+		Background, // 'FrameEnd' hands the frame's history to a collector thread, that computes the stats (no call tree nor window, 'GetStatsTable' lags by the frames in flight)
+	};
+
+	// Capture
+	enum class CaptureMode {
+		History, // Frame history only (no stats)
+		Stats,   // Stats only, no history buffer at all (always aggregated online, constant memory)
+		Both,    // Frame history + stats (aggregated as per AggregationMode)
+	};
+
+	// Time (clock)
+	enum class ClockMode {
+		Chrono, // std::chrono::steady_clock (ticks are nanoseconds)
+		RDTSC,  // Raw TSC, requires an invariant TSC (falls back to Chrono otherwise)
+		RDTSCP, // Raw TSC (serializing variant), requires an invariant TSC and 'rdtscp'
+	};
+
+	// Symbols
+	enum class SymbolMode {
+		InProcess, // 'GetFuncInfo' resolves names inside the process (DbgHelp / ELF)
+		Deferred,  // 'GetFuncInfo' yields "module+offset" placeholders: dump, then resolve offline ('profiler-symbolize')
+	};
+	enum class SymbolLoad {
+		Lazy,  // One platform lookup per newly seen function
+		Eager, // Every function symbol of the loaded modules is read up front, lookups are a binary search
+	};
 
 	// Structs
+	// Names point into the process-wide interned string pool or the mapped symbol cache (NUL-terminated, never freed)
 	struct FuncInfo {
 		FuncID id = EmptyFuncID;
-		char funcName[1024] = { {'\0'} };
-		char funcNameExt[1024] = { {'\0'} };
-		char fileName[1024] = { {'\0'} };
-		size_t funcNameLen = 0;
-		size_t funcNameExtLen = 0;
-		size_t fileNameLen = 0;
+		const char* funcName = "";
+		const char* funcNameExt = "";
+		const char* fileName = "";
+		unsigned int funcNameLen = 0;
+		unsigned int funcNameExtLen = 0;
+		unsigned int fileNameLen = 0;
 		int fileLine = 0;
 	};
-	using InfoTable = std::unordered_map<FuncID, FuncInfo>;
+
+	// A module loaded in the process (see 'GetModules').
+	// Offline, a FuncID is looked up as (FuncID - bias) inside 'path'.
+	struct ModuleInfo {
+		std::string path;
+		std::string buildId; // Hex (GNU build-id / PDB GUID + age), empty if none
+		unsigned long long base = 0; // Runtime range
+		unsigned long long size = 0;
+		unsigned long long bias = 0; // Load bias (ELF) / image base (PE)
+	};
+
+	// Process-wide view over the symbol cache (see 'GetFuncInfo').
+	// Iterating yields (FuncID, FuncInfo) pairs of the functions resolved so far.
+	class DLLAPI InfoTable {
+	public:
+		using value_type = std::pair<FuncID, const FuncInfo&>;
+
+		class DLLAPI const_iterator {
+		public:
+			using iterator_category = std::forward_iterator_tag;
+			using value_type = InfoTable::value_type;
+			using difference_type = std::ptrdiff_t;
+			using reference = value_type;
+
+			const_iterator(FuncIndex index, FuncIndex count) : _index(index), _count(count) { __Skip(); }
+			reference operator*() const;
+			const_iterator& operator++() { ++_index; __Skip(); return *this; }
+			const_iterator operator++(int) { const_iterator old = *this; ++(*this); return old; }
+			bool operator==(const const_iterator& other) const { return _index == other._index; }
+			bool operator!=(const const_iterator& other) const { return _index != other._index; }
+			FuncIndex index() const { return _index; }
+
+		private:
+			void __Skip();
+
+		private:
+			FuncIndex _index;
+			FuncIndex _count;
+		};
+
+		static constexpr FuncIndex EndIndex = (FuncIndex)-1;
+
+		const FuncInfo* find(FuncID func) const; // nullptr when not resolved (yet)
+		const FuncInfo& at(FuncID func) const;   // throws std::out_of_range
+		bool contains(FuncID func) const { return find(func) != nullptr; }
+		size_t size() const; // O(n)
+		const_iterator begin() const;
+		const_iterator end() const;
+	};
+	// Durations are raw ticks: converted only for display (see 'TicksToNs')
 	struct FuncStats {
-		DeltaUs usTot = 0;
-		DeltaUs usMin = 1'000'000'000;
-		DeltaUs usMax = 0;
-		DeltaUs usAvg = 0;
+		DeltaTicks ticksTot = 0; // Inclusive, every activation (recursive calls are counted at each level)
+		DeltaTicks ticksMin = std::numeric_limits<DeltaTicks>::max();
+		DeltaTicks ticksMax = 0;
+		DeltaTicks ticksSelfTot = 0; // Exclusive (callees excluded)
+		DeltaTicks ticksCollapsedTot = 0; // Inclusive, outermost activations only (recursion collapsed)
+		double ticksMean = 0; // Running mean and sum of squared deviations (Welford)
+		double ticksM2 = 0;
 		int invocationCount = 0;
+
+		DeltaTicks ticksAvg() const { return invocationCount > 0 ? ticksTot / invocationCount : 0; }
+		double ticksVariance() const { return invocationCount > 1 ? ticksM2 / (invocationCount - 1) : 0.0; } // Sample variance
+		double ticksStddev() const { return std::sqrt(ticksVariance()); }
+		double cv() const { return ticksMean > 0 ? ticksStddev() / ticksMean : 0.0; } // Coefficient of variation (unitless)
+
+		// Accounts for one call of 'ticks' (inclusive) only: see the overload below for self and collapsed times
+		inline void record(DeltaTicks ticks) {
+			invocationCount++;
+			ticksMin = std::min(ticksMin, ticks);
+			ticksMax = std::max(ticksMax, ticks);
+			ticksTot += ticks;
+			double delta = (double)ticks - ticksMean;
+			ticksMean += delta / invocationCount;
+			ticksM2 += delta * ((double)ticks - ticksMean);
+		}
+		// Accounts for one exit: 'self' excludes the callees, 'outermost' if no activation of the same function is still running
+		inline void record(DeltaTicks ticks, DeltaTicks self, bool outermost) {
+			record(ticks);
+			ticksSelfTot += self;
+			ticksCollapsedTot += outermost ? ticks : 0;
+		}
+		// Combine with stats of another thread / window (Chan et al. parallel variance)
+		void merge(const FuncStats& other) {
+			if (other.invocationCount == 0) return;
+			const double n = (double)invocationCount + other.invocationCount;
+			const double delta = other.ticksMean - ticksMean;
+			ticksM2 += other.ticksM2 + delta * delta * ((double)invocationCount * other.invocationCount / n);
+			ticksMean += delta * (other.invocationCount / n);
+			ticksTot += other.ticksTot;
+			ticksMin = std::min(ticksMin, other.ticksMin);
+			ticksMax = std::max(ticksMax, other.ticksMax);
+			ticksSelfTot += other.ticksSelfTot;
+			ticksCollapsedTot += other.ticksCollapsedTot;
+			invocationCount += other.invocationCount;
+		}
+	};
+
+	// Log-linear (HDR-style) latency histogram, fixed memory (~3KB).
+	// Durations below 2^SubBucketBits ticks are exact, above that every power of 2 is split into
+	// 2^SubBucketBits linear buckets (<= 1/16 relative error). Histograms merge by adding counts.
+	class DLLAPI LatencyHistogram {
+	public:
+		static constexpr int SubBucketBits = 4;
+		static constexpr int MaxBits = 48; // Longer durations land in the last bucket
+		static constexpr int BucketCount = (MaxBits - SubBucketBits + 1) << SubBucketBits;
+
+		inline void record(DeltaTicks ticks) {
+			_counts[__Bucket(ticks)]++;
+			_count++;
+		}
+		void merge(const LatencyHistogram& other);
+		void clear();
+		DeltaTicks percentile(double p) const; // 'p' in [0, 100], 0 if empty (middle of the bucket)
+		unsigned long long count() const { return _count; }
+
+	private:
+		static inline int __Bucket(DeltaTicks ticks) {
+			unsigned long long value = std::min<unsigned long long>((unsigned long long)std::max<DeltaTicks>(ticks, 0), (1ull << MaxBits) - 1);
+			if (value < (1ull << SubBucketBits)) return (int)value;
+			int shift = (int)std::bit_width(value) - 1 - SubBucketBits;
+			return ((shift + 1) << SubBucketBits) + (int)((value >> shift) - (1ull << SubBucketBits));
+		}
+
+	private:
+		unsigned int _counts[BucketCount] = {};
+		unsigned long long _count = 0;
+	};
+
+	// Stats of every function, stored contiguously and indexed by FuncIndex.
+	// Iterating yields (FuncID, FuncStats) pairs of the functions that have been called at least once.
+	class DLLAPI StatsTable {
+	public:
+		using value_type = std::pair<FuncID, const FuncStats&>;
+
+		class DLLAPI const_iterator {
+		public:
+			using iterator_category = std::forward_iterator_tag;
+			using value_type = StatsTable::value_type;
+			using difference_type = std::ptrdiff_t;
+			using reference = value_type;
+
+			const_iterator(const StatsTable* table, FuncIndex index) : _table(table), _index(index) { __Skip(); }
+			reference operator*() const;
+			const_iterator& operator++() { ++_index; __Skip(); return *this; }
+			const_iterator operator++(int) { const_iterator old = *this; ++(*this); return old; }
+			bool operator==(const const_iterator& other) const { return _index == other._index; }
+			bool operator!=(const const_iterator& other) const { return _index != other._index; }
+			FuncIndex index() const { return _index; }
+
+		private:
+			void __Skip() {
+				while (_index < _table->_stats.size() && _table->_stats[_index].invocationCount == 0)
+					++_index;
+			}
+
+		private:
+			const StatsTable* _table;
+			FuncIndex _index;
+		};
+
+		// Direct access (grows the table when needed)
+		inline FuncStats& operator[](FuncIndex index) {
+			if (index >= _stats.size()) [[unlikely]]
+				_stats.resize(std::max<size_t>(index + 1, _stats.size() * 2));
+			return _stats[index];
+		}
+		inline const FuncStats* find(FuncIndex index) const {
+			return (index < _stats.size() && _stats[index].invocationCount != 0) ? &_stats[index] : nullptr;
+		}
+		// Latency histograms are only allocated for the functions that have been called
+		inline LatencyHistogram& histogram(FuncIndex index) {
+			if (index >= _histograms.size()) [[unlikely]]
+				_histograms.resize(std::max<size_t>(index + 1, _histograms.size() * 2));
+			if (_histograms[index] == nullptr) [[unlikely]]
+				_histograms[index] = std::make_unique<LatencyHistogram>();
+			return *_histograms[index];
+		}
+		inline const LatencyHistogram* findHistogram(FuncIndex index) const {
+			return index < _histograms.size() ? _histograms[index].get() : nullptr;
+		}
+		// Accounts for one exit (see 'FuncStats::record'), latency histogram included: every aggregation path goes through here
+		inline FuncStats& record(FuncIndex index, DeltaTicks ticks, DeltaTicks self, bool outermost) {
+			FuncStats& entry = (*this)[index];
+			entry.record(ticks, self, outermost);
+			histogram(index).record(ticks);
+			return entry;
+		}
+		const LatencyHistogram* findHistogram(FuncID func) const;
+		void merge(const StatsTable& other); // Adds 'other' (e.g. another thread's stats)
+
+		// Lookup by FuncID ('at' throws std::out_of_range, like std::unordered_map)
+		const FuncStats* find(FuncID func) const;
+		const FuncStats& at(FuncID func) const;
+		bool contains(FuncID func) const { return find(func) != nullptr; }
+
+		StatsTable() = default;
+		StatsTable(const StatsTable& other);
+		StatsTable& operator=(const StatsTable& other);
+		StatsTable(StatsTable&&) = default;
+		StatsTable& operator=(StatsTable&&) = default;
+
+		size_t size() const; // Functions with stats (O(n))
+		bool empty() const { return begin() == end(); }
+		void clear() { _stats.clear(); _histograms.clear(); }
+		const_iterator begin() const { return const_iterator(this, 0); }
+		const_iterator end() const { return const_iterator(this, (FuncIndex)_stats.size()); }
+
+	private:
+		std::vector<FuncStats> _stats{};
+		std::vector<std::unique_ptr<LatencyHistogram>> _histograms{};
+	};
+
+	// Threads
+	using ThreadIndex = unsigned int; // Registration order (first instrumented event)
+	struct ThreadInfo {
+		ThreadIndex index = 0;
+		unsigned long long osId = 0;
+		std::string name; // See 'SetThreadName'
+		bool exited = false; // Its final frame and stats are retained
+	};
+
+	// Calling-context tree
+	using CallNodeIndex = unsigned int;
+	struct CallNode {
+		FuncIndex func = 0;
+		CallNodeIndex parent = 0;
+		CallNodeIndex firstChild = 0; // 0 if none (the root is nobody's child)
+		CallNodeIndex nextSibling = 0;
+		int invocationCount = 0;
+		DeltaTicks ticksTot = 0; // Inclusive
+		DeltaTicks ticksSelfTot = 0; // Exclusive (callees excluded)
+	};
+
+	// Stats per call path: one node per (parent node, FuncIndex), see 'SetCallTreeCapture'.
+	// Nodes are stored contiguously (indices are stable), node 0 is the empty root.
+	class DLLAPI CallTree {
+	public:
+		static constexpr CallNodeIndex Root = 0;
+
+		CallTree() { clear(); }
+
+		// Child of 'parent' calling 'func' (added when needed)
+		inline CallNodeIndex child(CallNodeIndex parent, FuncIndex func) {
+			size_t slot = __Hash(parent, func) & _mask;
+			for (;;) {
+				CallNodeIndex index = _slots[slot];
+				if (index == 0) [[unlikely]]
+					return __Insert(parent, func, slot);
+				if (_nodes[index].parent == parent && _nodes[index].func == func)
+					return index;
+				slot = (slot + 1) & _mask;
+			}
+		}
+		inline CallNode& operator[](CallNodeIndex index) { return _nodes[index]; }
+		inline const CallNode& operator[](CallNodeIndex index) const { return _nodes[index]; }
+		const CallNode* find(CallNodeIndex parent, FuncID func) const; // nullptr if that path was never taken
+
+		size_t size() const { return _nodes.size(); } // Root included
+		bool empty() const { return _nodes.size() <= 1; }
+		void clear();
+
+	private:
+		static inline size_t __Hash(CallNodeIndex parent, FuncIndex func) {
+			return (size_t)((((unsigned long long)parent << 32) | func) * 0x9E3779B97F4A7C15ull >> 16);
+		}
+		CallNodeIndex __Insert(CallNodeIndex parent, FuncIndex func, size_t slot);
+
+	private:
+		std::vector<CallNode> _nodes{};
+		std::vector<CallNodeIndex> _slots{}; // Open addressing on (parent, func), 0 if empty
+		size_t _mask = 0;
 	};
-	using StatsTable = std::unordered_map<FuncID, FuncStats>;
 	struct FrameHistoryEntry {
 		FuncID id = nullptr;
 		TimeStamp time{};
 	};
-	using FrameHistory = std::vector<profiler::FrameHistoryEntry>;
+
+	// History
+	enum class OverflowPolicy {
+		DropNewest, // Once full, new events are discarded (keeps the frame's beginning)
+		DropOldest, // Once full, the oldest events are overwritten (keeps the frame's end)
+	};
+	constexpr size_t FrameHistoryChunkSize = 4096; // Events per chunk (power of 2)
+	constexpr size_t FrameHistoryDefaultCapacity = 1 << 18;
+
+	// Packed event (8 bytes):
+	//   [63:62] kind
+	//   Enter: [61:32] delta from previous event, [31:0] FuncIndex
+	//   Exit:  [61:0]  delta from previous event (no FuncIndex, it's implied by the enter)
+	//   Time:  [61:0]  absolute TimeStamp (escape, emitted when the delta doesn't fit)
+	using FrameHistoryEvent = unsigned long long int;
+
+	// Fixed-capacity ring buffer of packed events, stored in cache-line aligned chunks.
+	// Memory is allocated once (see 'reserve') and never moved nor reallocated while recording.
+	// Iteration decodes events back into 'FrameHistoryEntry'.
+	class DLLAPI FrameHistory {
+	public:
+		struct alignas(64) Chunk {
+			FrameHistoryEvent events[FrameHistoryChunkSize];
+		};
+
+		class DLLAPI const_iterator {
+		public:
+			using iterator_category = std::forward_iterator_tag;
+			using value_type = FrameHistoryEntry;
+			using difference_type = std::ptrdiff_t;
+			using pointer = const FrameHistoryEntry*;
+			using reference = const FrameHistoryEntry&;
+
+			const_iterator(const FrameHistory* history, size_t index, TimeStamp time);
+			reference operator*() const { return _entry; }
+			pointer operator->() const { return &_entry; }
+			const_iterator& operator++() { ++_index; __Decode(); return *this; }
+			const_iterator operator++(int) { const_iterator old = *this; ++(*this); return old; }
+			bool operator==(const const_iterator& other) const { return _index == other._index; }
+			bool operator!=(const const_iterator& other) const { return _index != other._index; }
+			FuncIndex funcIndex() const { return _funcIndex; } // Valid for enter events
+
+		private:
+			void __Decode();
+
+		private:
+			const FrameHistory* _history;
+			size_t _index;
+			FrameHistoryEntry _entry;
+			FuncIndex _funcIndex = 0;
+		};
+
+		static constexpr int EventKindShift = 62;
+		static constexpr FrameHistoryEvent EventExit = 0ULL << EventKindShift;
+		static constexpr FrameHistoryEvent EventEnter = 1ULL << EventKindShift;
+		static constexpr FrameHistoryEvent EventTime = 2ULL << EventKindShift;
+		static constexpr FrameHistoryEvent EventKindMask = 3ULL << EventKindShift;
+		static constexpr FrameHistoryEvent EventPayloadMask = ~EventKindMask;
+		static constexpr FrameHistoryEvent EnterDeltaMax = (1ULL << 30) - 1;
+
+		FrameHistory() = default;
+		FrameHistory(size_t capacity, OverflowPolicy policy = OverflowPolicy::DropNewest);
+		FrameHistory(const FrameHistory& other);
+		FrameHistory(FrameHistory&& other) noexcept; // 'other' is left empty, without storage
+		FrameHistory& operator=(const FrameHistory& other);
+		FrameHistory& operator=(FrameHistory&& other) noexcept;
+
+		// (Re)Allocate storage: capacity is rounded up to a power of 2 (at least 1 chunk). Clears content.
+		void reserve(size_t capacity, OverflowPolicy policy);
+		// Same as 'reserve', but storage is allocated by the first pushed event
+		static FrameHistory Lazy(size_t capacity, OverflowPolicy policy);
+		void clear() noexcept;
+
+		inline void pushEnter(FuncIndex func, TimeStamp time) noexcept {
+			TimeStamp delta = time - _lastTime;
+			if (delta > EnterDeltaMax) [[unlikely]] {
+				if (!__Push(EventTime | (time & EventPayloadMask))) return;
+				_lastTime = time;
+				delta = 0;
+			}
+			if (__Push(EventEnter | (delta << 32) | func))
+				_lastTime = time;
+		}
+
+		inline void pushExit(TimeStamp time) noexcept {
+			TimeStamp delta = time - _lastTime;
+			if (delta > EventPayloadMask) [[unlikely]] {
+				if (!__Push(EventTime | (time & EventPayloadMask))) return;
+				_lastTime = time;
+				delta = 0;
+			}
+			if (__Push(EventExit | delta))
+				_lastTime = time;
+		}
+
+		inline size_t size() const noexcept { return _size; } // Packed events (time escapes included)
+		inline bool empty() const noexcept { return _size == 0; }
+		inline size_t capacity() const noexcept { return _capacity; }
+		inline size_t dropped() const noexcept { return _dropped; } // Events lost to overflow
+		inline OverflowPolicy policy() const noexcept { return _policy; }
+		inline TimeStamp backTime() const noexcept { return _lastTime; } // Time of the last stored event
+		inline TimeStamp baseTime() const noexcept { return _baseTime; } // Decoding of 'at(0)' starts from here
+		inline FrameHistoryEvent at(size_t i) const noexcept { return __At(i); } // Packed (time escapes included), 'i' < 'size()'
+		inline const_iterator begin() const noexcept { return const_iterator(this, 0, _baseTime); }
+		inline const_iterator end() const noexcept { return const_iterator(this, _size, _lastTime); }
+
+	private:
+		inline bool __Push(FrameHistoryEvent ev) noexcept {
+			if (_size == _capacity) [[unlikely]] {
+				if (!__Overflow()) return false;
+			}
+			size_t index = (_head + _size) & _mask;
+			_chunks[index / FrameHistoryChunkSize]->events[index % FrameHistoryChunkSize] = ev;
+			_size++;
+			return true;
+		}
+
+		inline FrameHistoryEvent __At(size_t i) const noexcept {
+			size_t index = (_head + i) & _mask;
+			return _chunks[index / FrameHistoryChunkSize]->events[index % FrameHistoryChunkSize];
+		}
+
+		bool __Overflow() noexcept;
+
+	private:
+		std::vector<std::unique_ptr<Chunk>> _chunks{};
+		size_t _capacity = 0;
+		size_t _lazyCapacity = 0;
+		size_t _mask = 0;
+		size_t _head = 0;
+		size_t _size = 0;
+		size_t _dropped = 0;
+		TimeStamp _baseTime = 0; // Decoding starts from here (time "before" the oldest stored event)
+		TimeStamp _lastTime = 0; // Encoding continues from here
+		OverflowPolicy _policy = OverflowPolicy::DropNewest;
+	};
+
+	// Collector
+	// Called on the collector thread for every frame it aggregates ('stats' is the thread's lifetime table)
+	using CollectorCallback = std::function<void(ThreadIndex thread, const FrameHistory& frame, const StatsTable& stats)>;
 
 	// Apis
 	DLLAPI bool Enable();
 	DLLAPI bool Disable();
-	DLLAPI void FrameStart();
+	DLLAPI void FrameStart(); // The first thread calling it also starts a new frame on every thread that never does (on their next event)
 	DLLAPI void FrameEnd();
 	DLLAPI void ClearStats();
 	DLLAPI const FuncInfo& GetFuncInfo(FuncID func);
 	DLLAPI const InfoTable& GetInfoTable();
 	DLLAPI const FuncStats& GetFuncStats(FuncID func);
-	DLLAPI const StatsTable& GetStatsTable();
-	DLLAPI const FrameHistory& GetFrameHistory();
+	DLLAPI const StatsTable& GetStatsTable(); // Lifetime (since the last 'ClearStats'), as published by the collector in Background
+	DLLAPI void SetStatsWindow(size_t frames, double seconds = 0.0); // Window of the last 'frames' frames (0 disables), within the last 'seconds' if > 0
+	DLLAPI const StatsTable& GetWindowStatsTable(); // Caller thread's window stats (no latency histograms)
+	DLLAPI void SetThreadName(const char* name); // Caller thread
+	DLLAPI std::vector<ThreadInfo> GetThreads();
+	DLLAPI bool GetThreadFrameHistory(ThreadIndex thread, FrameHistory& out); // Copy of its last sealed frame (its final one once it exited, its last collected one in Background)
+	DLLAPI bool GetThreadStatsTable(ThreadIndex thread, StatsTable& out); // Copy of its stats as of its last sealed frame
+	DLLAPI StatsTable GetMergedStatsTable(); // Every thread's stats as of their last sealed frame
+	DLLAPI void SetCollectorCallback(CollectorCallback callback); // See 'AggregationMode::Background'
+	DLLAPI const CallTree& GetCallTree();
+	DLLAPI void SetCallTreeCapture(bool enabled); // Also aggregate per call path (off by default)
+	DLLAPI bool GetCallTreeCapture();
+	DLLAPI const FrameHistory& GetFrameHistory(); // Caller thread's last sealed frame (its last collected one in Background, lagging as 'GetStatsTable')
+	DLLAPI size_t GetDroppedFrames(); // Caller thread's frames dropped in Background (the collector was a whole queue behind)
+	DLLAPI void SetFrameHistoryCapacity(size_t capacity, OverflowPolicy policy = OverflowPolicy::DropNewest);
+	DLLAPI void SetAggregationMode(AggregationMode mode);
+	DLLAPI AggregationMode GetAggregationMode();
+	DLLAPI void SetAggregationThreads(unsigned int count); // Replay of large frames (at least half 'FrameHistoryDefaultCapacity' events) on 'count' threads (the caller included), 1 (default) is serial
+	DLLAPI unsigned int GetAggregationThreads();
+	DLLAPI void SetCaptureMode(CaptureMode mode);
+	DLLAPI CaptureMode GetCaptureMode();
+	DLLAPI bool SetClockMode(ClockMode mode);
+	DLLAPI ClockMode GetClockMode();
+	DLLAPI double GetClockNsPerTick();
+	DLLAPI void SetSymbolMode(SymbolMode mode); // Functions already resolved keep their FuncInfo
+	DLLAPI SymbolMode GetSymbolMode();
+	DLLAPI std::vector<ModuleInfo> GetModules();
+	DLLAPI bool SetSymbolCache(const char* path); // Persistent FuncInfo cache (nullptr disables it), call before resolving
+	DLLAPI void SetSymbolResolverThread(bool enabled); // Resolve in the background, 'GetFuncInfo' never blocks (placeholders meanwhile)
+	DLLAPI bool GetSymbolResolverThread();
+	DLLAPI void SetSymbolLoad(SymbolLoad load); // Eager: builds the symbol table now (blocking), Lazy: drops it
+	DLLAPI SymbolLoad GetSymbolLoad();
 
 	// Utils
 	DLLAPI void LogStats(const StatsTable& stats);
 	DLLAPI void LogStatsCompact(const StatsTable& stats);
+	DLLAPI void LogStatsTree(const CallTree& tree);
 	DLLAPI void LogHistory(const FrameHistory& history);
 	DLLAPI void LogHistoryCompact(const FrameHistory& history);
+	DLLAPI bool DumpStats(const StatsTable& stats, const char* path);   // Raw FuncIDs + module map
+	DLLAPI bool DumpHistory(const FrameHistory& history, const char* path); // Raw FuncIDs + module map
 
 	// Extra
 	using CRC32 = unsigned int;
 	DLLAPI CRC32 ComputeCRC32(const char* data, int len, CRC32 crc = 0);
 	constexpr CRC32 __ComputeCRC32(const char* data, int len, CRC32 crc = 0);
-	DLLAPI inline TimeStamp Now() noexcept;
-	DLLAPI inline DeltaUs ComputeDelta(TimeStamp beg, TimeStamp end) noexcept;
+	DLLAPI TimeStamp Now() noexcept;
+	DLLAPI DeltaUs ComputeDelta(TimeStamp beg, TimeStamp end) noexcept; // Truncated to whole microseconds
+	DLLAPI DeltaNs ComputeDeltaNs(TimeStamp beg, TimeStamp end) noexcept;
+	DLLAPI double TicksToNs(DeltaTicks ticks) noexcept;
 	
 	// Internals
-	void __GetFuncInfo(FuncID func, FuncInfo& info);
+	bool __GetFuncInfo(FuncID func, FuncInfo& info); // False if unresolved ('info' then holds an error placeholder)
+	void __EnumerateModules(std::vector<ModuleInfo>& out);
+	struct __SymbolEntry {
+		FuncInfo info; // 'id' is the start address
+		unsigned long long size;
+	};
+	void __EnumerateSymbols(std::vector<__SymbolEntry>& out); // Every function symbol of the loaded modules (unsorted)
+	bool __FindSymbolEntry(FuncID func, FuncInfo& info); // Eager symbol table lookup (see 'SetSymbolLoad')
+	bool __OpenSymbolCache(const char* path, const std::vector<ModuleInfo>& modules);
+	bool __FindCachedFuncInfo(const ModuleInfo& module, FuncID func, FuncInfo& info);
+	void __StoreCachedFuncInfo(const ModuleInfo& module, FuncID func, const FuncInfo& info);
+	const FuncInfo& __ResolveFuncIndex(FuncIndex index); // Blocking
+	void __EnqueueFuncIndex(FuncIndex index); // For the resolver thread, if running (never blocks)
+	void __LowerThreadPriority();
+	void __IgnoreThreadHooks(); // Library threads: their events are dropped (static builds, see 'LibraryScope')
+	unsigned long long __GetCurrentThreadOSID();
+	struct __CollectorChannel; // Capture thread -> collector (see 'AggregationMode::Background')
+	__CollectorChannel* __OpenCollectorChannel(ThreadIndex thread);
+	void __CloseCollectorChannel(__CollectorChannel* channel); // No submit afterwards, freed once drained
+	bool __SubmitFrame(__CollectorChannel* channel, FrameHistory& frame); // Swaps 'frame' for a recycled (empty) buffer, false if the collector is too far behind
+	void __ClearCollectedStats(__CollectorChannel* channel);
+	void __SeedCollectedStats(__CollectorChannel* channel, const StatsTable& stats); // Lifetime stats the collector goes on from (applied with the next submitted frame)
+	void __SetCollectorThread(bool enabled); // Stopping drains the frames submitted so far
+	bool __IsCollectorRunning();
+	bool __AggregateParallel(const FrameHistory& history, StatsTable& frame, std::vector<FuncIndex>& touched); // Adds the frame's calls to 'frame' (no stats for them yet), false if it must be replayed serially
+	void __PublishCollectedFrame(ThreadIndex thread, const StatsTable& stats, const std::vector<FuncIndex>& touched, FrameHistory& frame); // Swaps 'frame' with the published one
+	FuncIndex __InternFuncID(FuncID func);
+	bool __FindFuncIndex(FuncID func, FuncIndex& index);
+	FuncID __GetFuncIDFromIndex(FuncIndex index);
+	FuncIndex __GetFuncCount();
+	const FuncInfo* __FindFuncInfo(FuncIndex index);
+	const char* __InternString(const char* str, size_t len);
+	void __SetFuncInfoNames(FuncInfo& info, const char* funcName, const char* funcNameExt, const char* fileName);
+	constexpr size_t __FuncChunkSize = 1 << 16; // Per-function process-wide storage (never moves)
+	constexpr size_t __FuncChunkCount = 1 << 12;
 }
 
-// [NECESSARY] Since they're referenced inside 'hooks.asm'
+// [NECESSARY] Since they're referenced inside 'hooks.asm' (MSVC) and 'profilerlib_gcc.cpp' (GCC / Clang)
 extern "C" {
 	void PEnter(profiler::FuncID func);
 	void PExit(profiler::FuncID func);
@@ -0,0 +1,52 @@
+#include "profilerlib.hpp"
+
+//////////////////////////////////////////////////////////////////////////////
+// Calling-context tree (see 'SetCallTreeCapture').
+// Children are found through an open-addressing table keyed by (parent node, FuncIndex),
+// kept at most half full. Each node also links to its first child and next sibling to walk the tree.
+
+void profiler::CallTree::clear() {
+	_nodes.assign(1, CallNode{});
+	_slots.assign(64, 0);
+	_mask = _slots.size() - 1;
+}
+
+profiler::CallNodeIndex profiler::CallTree::__Insert(CallNodeIndex parent, FuncIndex func, size_t slot) {
+	//////////////////////////////////////////////////////////////////////////////
+	// 1. Grow (and rehash) the table past half full
+	if ((_nodes.size() + 1) * 2 > _slots.size()) {
+		_slots.assign(_slots.size() * 2, 0);
+		_mask = _slots.size() - 1;
+		for (CallNodeIndex index = 1; index < (CallNodeIndex)_nodes.size(); ++index) {
+			size_t s = __Hash(_nodes[index].parent, _nodes[index].func) & _mask;
+			while (_slots[s] != 0)
+				s = (s + 1) & _mask;
+			_slots[s] = index;
+		}
+		slot = __Hash(parent, func) & _mask;
+		while (_slots[slot] != 0)
+			slot = (slot + 1) & _mask;
+	}
+
+	//////////////////////////////////////////////////////////////////////////////
+	// 2. Append the node and link it under its parent
+	CallNodeIndex index = (CallNodeIndex)_nodes.size();
+	CallNode node{};
+	node.func = func;
+	node.parent = parent;
+	node.nextSibling = _nodes[parent].firstChild;
+	_nodes.push_back(node);
+	_nodes[parent].firstChild = index;
+	_slots[slot] = index;
+	return index;
+}
+
+const profiler::CallNode* profiler::CallTree::find(CallNodeIndex parent, FuncID func) const {
+	FuncIndex funcIndex = 0;
+	if (!__FindFuncIndex(func, funcIndex)) return nullptr;
+	for (size_t slot = __Hash(parent, funcIndex) & _mask; _slots[slot] != 0; slot = (slot + 1) & _mask) {
+		const CallNode& node = _nodes[_slots[slot]];
+		if (node.parent == parent && node.func == funcIndex) return &node;
+	}
+	return nullptr;
+}
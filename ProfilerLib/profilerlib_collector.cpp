@@ -0,0 +1,283 @@
+#include "profilerlib.hpp"
+
+#include <atomic>
+#include <mutex>
+#include <thread>
+
+//////////////////////////////////////////////////////////////////////////////
+// Background collector (see 'AggregationMode::Background').
+// Every capture thread owns a channel made of two single-producer / single-consumer rings:
+// sealed frames go to the collector through the first one, and their buffers come back, once
+// aggregated, through the second one (the free list). After the first few frames, capture
+// threads only swap buffers: no allocation, no lock, no aggregation.
+// A capture thread never waits: when the collector is a whole ring behind, the frame is dropped.
+
+constexpr size_t gCollectorQueueSize = 8; // power of 2 (frames in flight per thread)
+
+template <typename T, size_t Size>
+struct SpscRing {
+	T slots[Size] = {};
+	alignas(64) std::atomic<size_t> head = 0; // Consumer
+	alignas(64) std::atomic<size_t> tail = 0; // Producer
+
+	// Producer only
+	bool full() const {
+		return tail.load(std::memory_order_relaxed) - head.load(std::memory_order_acquire) == Size;
+	}
+	bool push(T& value) {
+		size_t pos = tail.load(std::memory_order_relaxed);
+		if (pos - head.load(std::memory_order_acquire) == Size) return false;
+		slots[pos & (Size - 1)] = std::move(value);
+		tail.store(pos + 1, std::memory_order_release);
+		return true;
+	}
+	// Consumer only
+	bool pop(T& value) {
+		size_t pos = head.load(std::memory_order_relaxed);
+		if (pos == tail.load(std::memory_order_acquire)) return false;
+		value = std::move(slots[pos & (Size - 1)]);
+		head.store(pos + 1, std::memory_order_release);
+		return true;
+	}
+};
+
+struct CollectorFuncState {
+	unsigned int depth = 0; // Activations on the replay stack (recursion)
+	unsigned int touched = 0; // Last frame serial it got stats in
+};
+
+struct CollectorStackEntry {
+	profiler::FuncIndex func;
+	profiler::TimeStamp start;
+	profiler::DeltaTicks children;
+};
+
+struct profiler::__CollectorChannel {
+	SpscRing<FrameHistory, gCollectorQueueSize> sealed{}; // Capture thread -> collector
+	SpscRing<FrameHistory, gCollectorQueueSize> free{}; // Collector -> capture thread
+	std::atomic<bool> closed = false; // Set after the last push (thread exit)
+	std::atomic<bool> clear = false; // See 'ClearStats'
+	std::atomic<bool> seeded = false; // See '__SeedCollectedStats'
+	StatsTable seed{}; // Written before 'seeded' is set, read once it is
+	ThreadIndex thread = 0;
+
+	// Collector only
+	FrameHistory frame{};
+	StatsTable stats{}; // Lifetime
+	std::vector<CollectorStackEntry> stack{};
+	std::vector<CollectorFuncState> funcs{};
+	std::vector<FuncIndex> touched{};
+	unsigned int serial = 1;
+};
+
+alignas(64) static std::atomic<unsigned int> gCollectorSignal = 0; // Bumped on push, waited on when idle
+static std::atomic<bool> gCollectorStop = false;
+static std::atomic<bool> gCollectorRunning = false; // Capture threads replay their frames themselves otherwise
+static std::mutex gCollectorControlLock{};
+static std::thread gCollectorThread{};
+static std::mutex gChannelsLock{};
+static auto& gChannels = *new std::vector<profiler::__CollectorChannel*>();
+static std::atomic<unsigned int> gChannelsVersion = 0; // Bumped on open / free
+static std::mutex gCollectorCallbackLock{};
+static auto& gCollectorCallback = *new profiler::CollectorCallback();
+
+//////////////////////////////////////////////////////////////////////////////
+
+// Same accounting as the capture threads (see '__PopStack'), without call tree nor window
+static void __Replay(profiler::__CollectorChannel& channel) {
+	for (auto it = channel.frame.begin(); it != channel.frame.end(); ++it) {
+		if (it->id != profiler::EmptyFuncID) {
+			const profiler::FuncIndex func = it.funcIndex();
+			channel.stack.push_back({ .func = func, .start = it->time, .children = 0 });
+			if (func >= channel.funcs.size()) [[unlikely]]
+				channel.funcs.resize(std::max<size_t>(func + 1, channel.funcs.size() * 2));
+			channel.funcs[func].depth++;
+			continue;
+		}
+		if (channel.stack.empty()) continue;
+		const CollectorStackEntry top = channel.stack.back();
+		channel.stack.pop_back();
+		profiler::DeltaTicks delta = (profiler::DeltaTicks)(it->time - top.start);
+		CollectorFuncState& state = channel.funcs[top.func];
+		bool outermost = (--state.depth == 0);
+		if (state.touched != channel.serial) {
+			state.touched = channel.serial;
+			channel.touched.push_back(top.func);
+		}
+		channel.stats.record(top.func, delta, delta - top.children, outermost);
+		if (!channel.stack.empty())
+			channel.stack.back().children += delta;
+	}
+	// Calls still running are dropped (as 'FrameEnd' does)
+	for (const CollectorStackEntry& e : channel.stack)
+		channel.funcs[e.func].depth--;
+	channel.stack.clear();
+}
+
+static void __Collect(profiler::__CollectorChannel& channel) {
+	if (channel.seeded.exchange(false, std::memory_order_acquire))
+		channel.stats = std::move(channel.seed);
+	if (channel.clear.exchange(false, std::memory_order_acquire))
+		channel.stats.clear();
+	__Replay(channel);
+	{
+		std::lock_guard<std::mutex> lock(gCollectorCallbackLock);
+		if (gCollectorCallback)
+			gCollectorCallback(channel.thread, channel.frame, channel.stats);
+	}
+	// Gets the previously published frame back
+	profiler::__PublishCollectedFrame(channel.thread, channel.stats, channel.touched, channel.frame);
+	channel.touched.clear();
+	channel.serial++;
+	if (!channel.free.push(channel.frame))
+		channel.frame = profiler::FrameHistory{};
+}
+
+static void __Drain(profiler::__CollectorChannel& channel) {
+	while (channel.sealed.pop(channel.frame))
+		__Collect(channel);
+}
+
+static void __CollectorMain() {
+	profiler::__LowerThreadPriority(); // Capture threads come first
+	profiler::__IgnoreThreadHooks();
+	std::vector<profiler::__CollectorChannel*> channels;
+	unsigned int version = gChannelsVersion.load(std::memory_order_acquire) - 1;
+	for (;;) {
+		unsigned int signal = gCollectorSignal.load(std::memory_order_acquire);
+		const bool stop = gCollectorStop.load(std::memory_order_acquire);
+		if (version != gChannelsVersion.load(std::memory_order_acquire)) {
+			std::lock_guard<std::mutex> lock(gChannelsLock);
+			version = gChannelsVersion.load(std::memory_order_relaxed);
+			channels = gChannels;
+		}
+
+		//////////////////////////////////////////////////////////////////////////////
+		// 1. Drain every channel, freeing the closed ones (nothing comes after 'closed')
+		bool freed = false;
+		for (profiler::__CollectorChannel*& channel : channels) {
+			const bool closed = channel->closed.load(std::memory_order_acquire);
+			__Drain(*channel);
+			if (!closed) continue;
+			std::lock_guard<std::mutex> lock(gChannelsLock);
+			gChannels.erase(std::find(gChannels.begin(), gChannels.end(), channel));
+			delete channel;
+			channel = nullptr;
+			freed = true;
+		}
+		if (freed) {
+			std::lock_guard<std::mutex> lock(gChannelsLock);
+			gChannelsVersion.fetch_add(1, std::memory_order_release);
+			channels.erase(std::remove(channels.begin(), channels.end(), nullptr), channels.end());
+		}
+
+		//////////////////////////////////////////////////////////////////////////////
+		// 2. Sleep until something is pushed (or stop, once drained)
+		if (stop) return;
+		gCollectorSignal.wait(signal, std::memory_order_acquire);
+	}
+}
+
+// The caller holds 'gCollectorControlLock'
+static void __StopCollectorThread() {
+	if (!gCollectorThread.joinable()) return;
+	gCollectorRunning.store(false, std::memory_order_relaxed);
+	gCollectorStop.store(true, std::memory_order_release);
+	gCollectorSignal.fetch_add(1, std::memory_order_release);
+	gCollectorSignal.notify_all();
+	gCollectorThread.join();
+
+	//////////////////////////////////////////////////////////////////////////////
+	// Final drain: frames submitted while it was stopping, channels closed since its last pass
+	// (this thread is the only consumer left: capture threads replay their frames from now on)
+	std::lock_guard<std::mutex> lock(gChannelsLock);
+	for (profiler::__CollectorChannel*& channel : gChannels) {
+		const bool closed = channel->closed.load(std::memory_order_acquire);
+		__Drain(*channel);
+		if (!closed) continue;
+		delete channel;
+		channel = nullptr;
+	}
+	gChannels.erase(std::remove(gChannels.begin(), gChannels.end(), nullptr), gChannels.end());
+	gChannelsVersion.fetch_add(1, std::memory_order_release);
+}
+
+// Joins the thread before static destruction ('std::thread' must not be destroyed joinable)
+static struct CollectorGuard {
+	~CollectorGuard() {
+		std::lock_guard<std::mutex> lock(gCollectorControlLock);
+		__StopCollectorThread();
+	}
+} gCollectorGuard{};
+
+//////////////////////////////////////////////////////////////////////////////
+
+profiler::__CollectorChannel* profiler::__OpenCollectorChannel(ThreadIndex thread) {
+	__CollectorChannel* channel = new __CollectorChannel();
+	channel->thread = thread;
+	std::lock_guard<std::mutex> lock(gChannelsLock);
+	gChannels.push_back(channel);
+	gChannelsVersion.fetch_add(1, std::memory_order_release);
+	return channel;
+}
+
+void profiler::__CloseCollectorChannel(__CollectorChannel* channel) {
+	std::lock_guard<std::mutex> control(gCollectorControlLock);
+	if (!gCollectorThread.joinable()) {
+		// Nobody left to free it: drained and freed here (the collector cannot start meanwhile)
+		std::lock_guard<std::mutex> lock(gChannelsLock);
+		__Drain(*channel);
+		gChannels.erase(std::find(gChannels.begin(), gChannels.end(), channel));
+		gChannelsVersion.fetch_add(1, std::memory_order_release);
+		delete channel;
+		return;
+	}
+	channel->closed.store(true, std::memory_order_release);
+	gCollectorSignal.fetch_add(1, std::memory_order_release);
+	gCollectorSignal.notify_one();
+}
+
+bool profiler::__SubmitFrame(__CollectorChannel* channel, FrameHistory& frame) {
+	if (channel->sealed.full()) return false;
+	// Buffers only come back once aggregated: the first frames get new (empty) ones
+	FrameHistory recycled{};
+	channel->free.pop(recycled);
+	recycled.clear();
+	std::swap(frame, recycled);
+	channel->sealed.push(recycled);
+	gCollectorSignal.fetch_add(1, std::memory_order_release);
+	gCollectorSignal.notify_one();
+	return true;
+}
+
+void profiler::__ClearCollectedStats(__CollectorChannel* channel) {
+	channel->clear.store(true, std::memory_order_release);
+}
+
+void profiler::__SeedCollectedStats(__CollectorChannel* channel, const StatsTable& stats) {
+	// Only called before the first frame submitted since the collector (re)started: the previous
+	// seed, if any, was taken by a frame drained before it stopped
+	channel->seed = stats;
+	channel->seeded.store(true, std::memory_order_release);
+}
+
+void profiler::__SetCollectorThread(bool enabled) {
+	std::lock_guard<std::mutex> lock(gCollectorControlLock);
+	if (enabled == gCollectorThread.joinable()) return;
+	if (!enabled) {
+		__StopCollectorThread(); // Drains what was submitted so far
+		return;
+	}
+	gCollectorStop.store(false, std::memory_order_relaxed);
+	gCollectorThread = std::thread(__CollectorMain);
+	gCollectorRunning.store(true, std::memory_order_relaxed);
+}
+
+bool profiler::__IsCollectorRunning() {
+	return gCollectorRunning.load(std::memory_order_relaxed);
+}
+
+void profiler::SetCollectorCallback(CollectorCallback callback) {
+	std::lock_guard<std::mutex> lock(gCollectorCallbackLock);
+	gCollectorCallback = std::move(callback);
+}
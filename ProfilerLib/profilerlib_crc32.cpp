@@ -1,5 +1,3 @@
-#pragma once
-
 #include "profilerlib.hpp"
 
 static constexpr const profiler::CRC32 table[256] = {
@@ -64,7 +62,7 @@ profiler::CRC32 profiler::ComputeCRC32(const char* data, int len, profiler::CRC3
 constexpr profiler::CRC32 profiler::__ComputeCRC32(const char* data, int len, profiler::CRC32 crc /*= 0*/) {
     crc = crc ^ 0xFFFFFFFFU;
     for (int i = 0; i < len; i++) {
-        crc = table[*data ^ (crc & 0xFF)] ^ (crc >> 8);
+        crc = table[((unsigned char)*data ^ crc) & 0xFF] ^ (crc >> 8);
         data++;
     }
     crc = crc ^ 0xFFFFFFFFU;
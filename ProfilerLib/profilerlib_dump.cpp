@@ -0,0 +1,74 @@
+#include "profilerlib.hpp"
+
+#include <cstdio>
+
+//////////////////////////////////////////////////////////////////////////////
+// Text dumps, resolved offline by 'profiler-symbolize' (see SymbolMode::Deferred).
+// Nothing here touches symbol files: only raw FuncIDs and the module map are written.
+//
+//   profiler-dump 2
+//   clock <ns per tick>
+//   module <base> <size> <bias> <build-id | -> <path>
+//   stats <func> <count> <tot> <min> <max> <self> <collapsed>
+//   enter <func> <ticks>
+//   exit <ticks>
+//
+// Addresses are hex, everything else is decimal. Paths run until the end of the line.
+// Durations are raw ticks.
+
+std::vector<profiler::ModuleInfo> profiler::GetModules() {
+	std::vector<ModuleInfo> modules;
+	__EnumerateModules(modules);
+	return modules;
+}
+
+static FILE* __BeginDump(const char* path) {
+	FILE* file = fopen(path, "w");
+	if (file == nullptr) return nullptr;
+	fprintf(file, "profiler-dump 2\n");
+	fprintf(file, "clock %.9f\n", profiler::GetClockNsPerTick());
+	for (const profiler::ModuleInfo& module : profiler::GetModules()) {
+		fprintf(file, "module %llx %llx %llx %s %s\n",
+			module.base,
+			module.size,
+			module.bias,
+			module.buildId.empty() ? "-" : module.buildId.c_str(),
+			module.path.c_str()
+		);
+	}
+	return file;
+}
+
+static bool __EndDump(FILE* file) {
+	bool ok = ferror(file) == 0;
+	return (fclose(file) == 0) && ok;
+}
+
+bool profiler::DumpStats(const StatsTable& stats, const char* path) {
+	FILE* file = __BeginDump(path);
+	if (file == nullptr) return false;
+	for (const auto& [func, entry] : stats) {
+		fprintf(file, "stats %llx %d %lld %lld %lld %lld %lld\n",
+			(unsigned long long)func,
+			entry.invocationCount,
+			entry.ticksTot,
+			entry.ticksMin,
+			entry.ticksMax,
+			entry.ticksSelfTot,
+			entry.ticksCollapsedTot
+		);
+	}
+	return __EndDump(file);
+}
+
+bool profiler::DumpHistory(const FrameHistory& history, const char* path) {
+	FILE* file = __BeginDump(path);
+	if (file == nullptr) return false;
+	for (const auto& e : history) {
+		if (e.id != EmptyFuncID)
+			fprintf(file, "enter %llx %llu\n", (unsigned long long)e.id, e.time);
+		else
+			fprintf(file, "exit %llu\n", e.time);
+	}
+	return __EndDump(file);
+}
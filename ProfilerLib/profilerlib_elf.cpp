@@ -0,0 +1,630 @@
+#include "profilerlib_elf.hpp"
+
+#include <elf.h>
+#include <link.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <cxxabi.h>
+#include <algorithm>
+#include <climits>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+
+using namespace profiler::elf;
+using profiler::ModuleInfo;
+
+//////////////////////////////////////////////////////////////////////////////
+// https://refspecs.linuxfoundation.org/elf/gabi4+/contents.html
+// https://dwarfstd.org/doc/DWARF5.pdf (6.2 Line Number Information)
+
+static constexpr unsigned char DW_LNS_copy = 1;
+static constexpr unsigned char DW_LNS_advance_pc = 2;
+static constexpr unsigned char DW_LNS_advance_line = 3;
+static constexpr unsigned char DW_LNS_set_file = 4;
+static constexpr unsigned char DW_LNS_const_add_pc = 8;
+static constexpr unsigned char DW_LNS_fixed_advance_pc = 9;
+static constexpr unsigned char DW_LNE_end_sequence = 1;
+static constexpr unsigned char DW_LNE_set_address = 2;
+static constexpr unsigned char DW_LNE_define_file = 3;
+static constexpr unsigned long long DW_LNCT_path = 1;
+static constexpr unsigned long long DW_LNCT_directory_index = 2;
+static constexpr unsigned long long DW_FORM_block = 0x09;
+static constexpr unsigned long long DW_FORM_data1 = 0x0b;
+static constexpr unsigned long long DW_FORM_data2 = 0x05;
+static constexpr unsigned long long DW_FORM_data4 = 0x06;
+static constexpr unsigned long long DW_FORM_data8 = 0x07;
+static constexpr unsigned long long DW_FORM_data16 = 0x1e;
+static constexpr unsigned long long DW_FORM_string = 0x08;
+static constexpr unsigned long long DW_FORM_strp = 0x0e;
+static constexpr unsigned long long DW_FORM_udata = 0x0f;
+static constexpr unsigned long long DW_FORM_line_strp = 0x1f;
+
+// Bounds-checked little-endian reader. Any overrun clears 'ok' and yields zeros.
+struct __Reader {
+	const unsigned char* p;
+	const unsigned char* end;
+	bool ok = true;
+
+	bool has(size_t n) {
+		if ((size_t)(end - p) < n) ok = false;
+		return ok;
+	}
+	template<typename T>
+	T read() {
+		T value{};
+		if (has(sizeof(T))) {
+			memcpy(&value, p, sizeof(T));
+			p += sizeof(T);
+		}
+		return value;
+	}
+	void skip(size_t n) {
+		if (has(n)) p += n;
+	}
+	unsigned long long uleb() {
+		unsigned long long value = 0;
+		unsigned int shift = 0;
+		while (has(1)) {
+			const unsigned char byte = *p++;
+			if (shift < 64) value |= (unsigned long long)(byte & 0x7f) << shift;
+			shift += 7;
+			if ((byte & 0x80) == 0) break;
+		}
+		return value;
+	}
+	long long sleb() {
+		long long value = 0;
+		unsigned int shift = 0;
+		unsigned char byte = 0;
+		while (has(1)) {
+			byte = *p++;
+			if (shift < 64) value |= (long long)(byte & 0x7f) << shift;
+			shift += 7;
+			if ((byte & 0x80) == 0) break;
+		}
+		if (shift < 64 && (byte & 0x40)) value |= -(1LL << shift);
+		return value;
+	}
+	const char* str() {
+		const unsigned char* beg = p;
+		while (p < end && *p != '\0') ++p;
+		if (p >= end) {
+			ok = false;
+			return "";
+		}
+		++p;
+		return (const char*)beg;
+	}
+	unsigned long long offset(bool dwarf64) {
+		return dwarf64 ? read<unsigned long long>() : read<unsigned int>();
+	}
+};
+
+static std::string __HexString(const unsigned char* data, size_t size) {
+	static constexpr char digits[] = "0123456789abcdef";
+	std::string hex(size * 2, '0');
+	for (size_t i = 0; i < size; ++i) {
+		hex[i * 2 + 0] = digits[data[i] >> 4];
+		hex[i * 2 + 1] = digits[data[i] & 0xf];
+	}
+	return hex;
+}
+
+// Scan a note area for 'NT_GNU_BUILD_ID' (hex string, empty if none)
+static std::string __FindBuildId(const unsigned char* data, size_t size) {
+	__Reader r{ data, data + size };
+	while (r.ok && r.has(sizeof(Elf64_Nhdr))) {
+		const Elf64_Nhdr note = r.read<Elf64_Nhdr>();
+		const unsigned char* name = r.p;
+		r.skip((note.n_namesz + 3) & ~3u);
+		const unsigned char* desc = r.p;
+		r.skip((note.n_descsz + 3) & ~3u);
+		if (!r.ok) break;
+		if (note.n_type == NT_GNU_BUILD_ID && note.n_namesz == 4 && memcmp(name, "GNU", 4) == 0)
+			return __HexString(desc, note.n_descsz);
+	}
+	return {};
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// ElfImage
+
+ElfImage::~ElfImage() {
+	delete _debugImage;
+	if (_data != nullptr)
+		munmap((void*)_data, _size);
+}
+
+bool ElfImage::open(const char* path) {
+	//////////////////////////////////////////////////////////////////////////////
+	// 1. Map the whole file (pages are only touched for the sections we read)
+	const int fd = ::open(path, O_RDONLY | O_CLOEXEC);
+	if (fd < 0) return false;
+	struct stat st {};
+	void* data = MAP_FAILED;
+	if (fstat(fd, &st) == 0 && st.st_size >= (off_t)sizeof(Elf64_Ehdr))
+		data = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (data == MAP_FAILED) return false;
+	_data = (const unsigned char*)data;
+	_size = (size_t)st.st_size;
+	_path = path;
+
+	//////////////////////////////////////////////////////////////////////////////
+	// 2. Only 64-bit little-endian images are understood
+	const Elf64_Ehdr* ehdr = (const Elf64_Ehdr*)_data;
+	if (memcmp(ehdr->e_ident, ELFMAG, SELFMAG) != 0 ||
+		ehdr->e_ident[EI_CLASS] != ELFCLASS64 ||
+		ehdr->e_ident[EI_DATA] != ELFDATA2LSB)
+		return false;
+	return __LoadSections();
+}
+
+bool ElfImage::__LoadSections() {
+	const Elf64_Ehdr* ehdr = (const Elf64_Ehdr*)_data;
+	if (ehdr->e_shoff == 0 || ehdr->e_shentsize != sizeof(Elf64_Shdr) ||
+		ehdr->e_shoff + (unsigned long long)ehdr->e_shnum * sizeof(Elf64_Shdr) > _size ||
+		ehdr->e_shstrndx >= ehdr->e_shnum)
+		return false;
+	const Elf64_Shdr* shdrs = (const Elf64_Shdr*)(_data + ehdr->e_shoff);
+
+	auto sectionOf = [&](const Elf64_Shdr& shdr) -> Section {
+		// Compressed sections ('SHF_COMPRESSED') would need zlib: treat them as missing
+		if (shdr.sh_type == SHT_NOBITS || (shdr.sh_flags & SHF_COMPRESSED) ||
+			shdr.sh_offset + shdr.sh_size > _size)
+			return {};
+		return { _data + shdr.sh_offset, (size_t)shdr.sh_size };
+	};
+	const Section names = sectionOf(shdrs[ehdr->e_shstrndx]);
+
+	const Elf64_Shdr* symtab = nullptr;
+	const Elf64_Shdr* dynsym = nullptr;
+	for (unsigned int i = 0; i < ehdr->e_shnum; ++i) {
+		const Elf64_Shdr& shdr = shdrs[i];
+		const char* name = shdr.sh_name < names.size ? (const char*)names.data + shdr.sh_name : "";
+		if (shdr.sh_type == SHT_SYMTAB) symtab = &shdr;
+		else if (shdr.sh_type == SHT_DYNSYM) dynsym = &shdr;
+		else if (shdr.sh_type == SHT_NOTE && _buildId.empty()) {
+			const Section note = sectionOf(shdr);
+			if (note.data != nullptr) _buildId = __FindBuildId(note.data, note.size);
+		}
+		else if (strcmp(name, ".debug_line") == 0) _debugLine = sectionOf(shdr);
+		else if (strcmp(name, ".debug_line_str") == 0) _debugLineStr = sectionOf(shdr);
+		else if (strcmp(name, ".debug_str") == 0) _debugStr = sectionOf(shdr);
+	}
+
+	// '.dynsym' is a subset of '.symtab': only used on stripped images
+	const Elf64_Shdr* table = symtab != nullptr ? symtab : dynsym;
+	if (table != nullptr && table->sh_link < ehdr->e_shnum)
+		__LoadSymbols(sectionOf(*table), sectionOf(shdrs[table->sh_link]));
+	return true;
+}
+
+void ElfImage::__LoadSymbols(const Section& symtab, const Section& strtab) {
+	struct Candidate {
+		ElfSymbol symbol;
+		int rank; // Lower wins among aliases: global, then weak, then local
+	};
+	std::vector<Candidate> candidates;
+	const size_t count = symtab.size / sizeof(Elf64_Sym);
+	const Elf64_Sym* syms = (const Elf64_Sym*)symtab.data;
+	for (size_t i = 0; i < count; ++i) {
+		const Elf64_Sym& sym = syms[i];
+		const unsigned char type = ELF64_ST_TYPE(sym.st_info);
+		if ((type != STT_FUNC && type != STT_GNU_IFUNC) || sym.st_shndx == SHN_UNDEF || sym.st_value == 0)
+			continue;
+		if (sym.st_name == 0 || sym.st_name >= strtab.size)
+			continue;
+		const unsigned char bind = ELF64_ST_BIND(sym.st_info);
+		const int rank = bind == STB_GLOBAL ? 0 : bind == STB_WEAK ? 1 : 2;
+		candidates.push_back({ { sym.st_value, sym.st_size, (const char*)strtab.data + sym.st_name }, rank });
+	}
+
+	std::sort(candidates.begin(), candidates.end(), [](const Candidate& a, const Candidate& b) {
+		return a.symbol.addr != b.symbol.addr ? a.symbol.addr < b.symbol.addr : a.rank < b.rank;
+	});
+	_symbols.clear();
+	_symbols.reserve(candidates.size());
+	for (const Candidate& candidate : candidates)
+		if (_symbols.empty() || _symbols.back().addr != candidate.symbol.addr)
+			_symbols.push_back(candidate.symbol);
+}
+
+const ElfSymbol* ElfImage::findSymbol(unsigned long long addr) const {
+	auto it = std::upper_bound(_symbols.begin(), _symbols.end(), addr, [](unsigned long long addr, const ElfSymbol& sym) {
+		return addr < sym.addr;
+	});
+	if (it == _symbols.begin()) return nullptr;
+	--it;
+	if (it->size != 0 && addr >= it->addr + it->size) return nullptr;
+	return &*it;
+}
+
+bool ElfImage::findLine(unsigned long long addr, const char*& file, int& line) {
+	if (!_linesLoaded) {
+		_linesLoaded = true;
+		__LoadLines();
+	}
+	if (_debugLine.data == nullptr)
+		return _debugImage != nullptr && _debugImage->findLine(addr, file, line);
+
+	//////////////////////////////////////////////////////////////////////////////
+	// First row at 'addr' (function entries map to their declaration line),
+	// otherwise the last row before it, unless that one closes a sequence
+	auto it = std::lower_bound(_lines.begin(), _lines.end(), addr, [](const ElfLine& row, unsigned long long addr) {
+		return row.addr < addr;
+	});
+	auto exact = it;
+	while (exact != _lines.end() && exact->addr == addr && exact->line == 0)
+		++exact; // Skip the end of the previous sequence
+	if (exact != _lines.end() && exact->addr == addr)
+		it = exact;
+	else {
+		if (it == _lines.begin()) return false;
+		--it;
+	}
+	if (it->line == 0) return false;
+	file = _files[it->file];
+	line = (int)it->line;
+	return true;
+}
+
+void ElfImage::__LoadLines() {
+	//////////////////////////////////////////////////////////////////////////////
+	// 1. Debug info shipped apart (distro '-dbg' / '-dbgsym' packages)
+	if (_debugLine.data == nullptr) {
+		if (_buildId.size() > 2) {
+			const std::string path = "/usr/lib/debug/.build-id/" + _buildId.substr(0, 2) + "/" + _buildId.substr(2) + ".debug";
+			_debugImage = new ElfImage();
+			if (!_debugImage->open(path.c_str()) || _debugImage->_debugLine.data == nullptr) {
+				delete _debugImage;
+				_debugImage = nullptr;
+			}
+		}
+		return;
+	}
+
+	//////////////////////////////////////////////////////////////////////////////
+	// 2. Run every line program, then sort the rows for lookups
+	const unsigned char* p = _debugLine.data;
+	const unsigned char* end = _debugLine.data + _debugLine.size;
+	while (p < end && __ParseLineUnit(p, end)) {}
+	std::stable_sort(_lines.begin(), _lines.end(), [](const ElfLine& a, const ElfLine& b) {
+		// Sequence ends first, so that a sequence starting at the same address wins
+		return a.addr != b.addr ? a.addr < b.addr : (a.line != 0) < (b.line != 0);
+	});
+}
+
+bool ElfImage::__ParseLineUnit(const unsigned char*& p, const unsigned char* end) {
+	//////////////////////////////////////////////////////////////////////////////
+	// 1. Unit header
+	__Reader r{ p, end };
+	unsigned long long unitLength = r.read<unsigned int>();
+	const bool dwarf64 = unitLength == 0xffffffffull;
+	if (dwarf64) unitLength = r.read<unsigned long long>();
+	if (!r.ok || unitLength > (unsigned long long)(end - r.p)) return false;
+	r.end = r.p + unitLength;
+	p = r.end; // Next unit
+
+	const unsigned short version = r.read<unsigned short>();
+	if (version < 2 || version > 5) return true; // Unknown: skip the unit
+	if (version >= 5) {
+		r.read<unsigned char>(); // address_size
+		r.read<unsigned char>(); // segment_selector_size
+	}
+	const unsigned long long headerLength = r.offset(dwarf64);
+	if (!r.ok || headerLength > (unsigned long long)(r.end - r.p)) return true;
+	const unsigned char* program = r.p + headerLength;
+	const unsigned char minInstLength = r.read<unsigned char>();
+	if (version >= 4) r.read<unsigned char>(); // maximum_operations_per_instruction (VLIW only)
+	r.read<unsigned char>(); // default_is_stmt
+	const signed char lineBase = r.read<signed char>();
+	const unsigned char lineRange = r.read<unsigned char>();
+	const unsigned char opcodeBase = r.read<unsigned char>();
+	if (!r.ok || lineRange == 0 || opcodeBase == 0) return true;
+	unsigned char opcodeLengths[256] = {};
+	for (unsigned int i = 1; i < opcodeBase; ++i)
+		opcodeLengths[i] = r.read<unsigned char>();
+
+	//////////////////////////////////////////////////////////////////////////////
+	// 2. Directory and file tables
+	std::vector<const char*> dirs;
+	std::vector<std::pair<const char*, unsigned long long>> files; // (name, directory index)
+	if (version < 5) {
+		dirs.push_back(nullptr); // Compilation directory: not recorded in the line table
+		for (const char* dir = r.str(); r.ok && *dir != '\0'; dir = r.str())
+			dirs.push_back(dir);
+		files.push_back({ nullptr, 0 }); // File indices are 1-based
+		for (const char* name = r.str(); r.ok && *name != '\0'; name = r.str()) {
+			const unsigned long long dir = r.uleb();
+			r.uleb(); // mtime
+			r.uleb(); // length
+			files.push_back({ name, dir });
+		}
+	}
+	else {
+		auto sectionString = [](const Section& section, unsigned long long offset) -> const char* {
+			if (offset >= section.size || memchr(section.data + offset, '\0', section.size - offset) == nullptr)
+				return nullptr;
+			return (const char*)section.data + offset;
+		};
+		// Entries are described by (content type, form) pairs
+		auto parseEntries = [&](auto&& emit) -> bool {
+			const unsigned char formatCount = r.read<unsigned char>();
+			unsigned long long formats[2 * 255];
+			for (unsigned int i = 0; i < formatCount; ++i) {
+				formats[i * 2 + 0] = r.uleb();
+				formats[i * 2 + 1] = r.uleb();
+			}
+			const unsigned long long count = r.uleb();
+			for (unsigned long long e = 0; e < count && r.ok; ++e) {
+				const char* path = nullptr;
+				unsigned long long dir = 0;
+				for (unsigned int i = 0; i < formatCount; ++i) {
+					const char* str = nullptr;
+					unsigned long long value = 0;
+					switch (formats[i * 2 + 1]) {
+					case DW_FORM_string: str = r.str(); break;
+					case DW_FORM_line_strp: str = sectionString(_debugLineStr, r.offset(dwarf64)); break;
+					case DW_FORM_strp: str = sectionString(_debugStr, r.offset(dwarf64)); break;
+					case DW_FORM_udata: value = r.uleb(); break;
+					case DW_FORM_data1: value = r.read<unsigned char>(); break;
+					case DW_FORM_data2: value = r.read<unsigned short>(); break;
+					case DW_FORM_data4: value = r.read<unsigned int>(); break;
+					case DW_FORM_data8: value = r.read<unsigned long long>(); break;
+					case DW_FORM_data16: r.skip(16); break;
+					case DW_FORM_block: r.skip(r.uleb()); break;
+					default: return false; // Unknown size: the rest can't be parsed
+					}
+					if (formats[i * 2 + 0] == DW_LNCT_path) path = str;
+					else if (formats[i * 2 + 0] == DW_LNCT_directory_index) dir = value;
+				}
+				emit(path, dir);
+			}
+			return r.ok;
+		};
+		if (!parseEntries([&](const char* path, unsigned long long) { dirs.push_back(path); }) ||
+			!parseEntries([&](const char* path, unsigned long long dir) { files.push_back({ path, dir }); }))
+			return true;
+	}
+	if (!r.ok) return true;
+
+	// File table entries are interned lazily (most are headers never hit)
+	std::vector<unsigned int> fileIds(files.size(), UINT_MAX);
+	auto fileId = [&](unsigned long long index) -> unsigned int {
+		if (index >= files.size() || files[index].first == nullptr) return UINT_MAX;
+		if (fileIds[index] == UINT_MAX) {
+			std::string path = files[index].first;
+			const unsigned long long dir = files[index].second;
+			if (path[0] != '/' && dir < dirs.size() && dirs[dir] != nullptr)
+				path = std::string(dirs[dir]) + "/" + path;
+			fileIds[index] = (unsigned int)_files.size();
+			_files.push_back(profiler::__InternString(path.c_str(), path.size()));
+		}
+		return fileIds[index];
+	};
+
+	//////////////////////////////////////////////////////////////////////////////
+	// 3. Line number program (state machine, rows are kept per sequence)
+	r.p = program;
+	std::vector<ElfLine> sequence;
+	unsigned long long address = 0;
+	unsigned long long file = 1;
+	long long line = 1;
+	auto emitRow = [&]() {
+		const unsigned int id = fileId(file);
+		if (id != UINT_MAX && line > 0)
+			sequence.push_back({ address, id, (unsigned int)line });
+	};
+	auto endSequence = [&]() {
+		// Sequences at address 0 belong to functions discarded by the linker
+		if (!sequence.empty() && sequence.front().addr != 0) {
+			_lines.insert(_lines.end(), sequence.begin(), sequence.end());
+			_lines.push_back({ address, 0, 0 });
+		}
+		sequence.clear();
+		address = 0;
+		file = 1;
+		line = 1;
+	};
+
+	while (r.ok && r.p < r.end) {
+		const unsigned char opcode = r.read<unsigned char>();
+		if (opcode >= opcodeBase) {
+			// Special opcode: advance both address and line, then emit a row
+			const unsigned int adjusted = opcode - opcodeBase;
+			address += (adjusted / lineRange) * minInstLength;
+			line += lineBase + (int)(adjusted % lineRange);
+			emitRow();
+		}
+		else if (opcode == 0) {
+			const unsigned long long length = r.uleb();
+			if (length == 0 || !r.has(length)) break;
+			const unsigned char* next = r.p + length;
+			const unsigned char sub = r.read<unsigned char>();
+			if (sub == DW_LNE_end_sequence) endSequence();
+			else if (sub == DW_LNE_set_address && length == 9) address = r.read<unsigned long long>();
+			else if (sub == DW_LNE_define_file) {
+				files.push_back({ nullptr, 0 }); // Deprecated: keep the indices, ignore the entry
+				fileIds.push_back(UINT_MAX);
+			}
+			r.p = next;
+		}
+		else {
+			switch (opcode) {
+			case DW_LNS_copy: emitRow(); break;
+			case DW_LNS_advance_pc: address += r.uleb() * minInstLength; break;
+			case DW_LNS_advance_line: line += r.sleb(); break;
+			case DW_LNS_set_file: file = r.uleb(); break;
+			case DW_LNS_const_add_pc: address += ((255 - opcodeBase) / lineRange) * minInstLength; break;
+			case DW_LNS_fixed_advance_pc: address += r.read<unsigned short>(); break;
+			default:
+				// Standard opcodes without effect on (address, file, line)
+				for (unsigned int i = 0; i < opcodeLengths[opcode]; ++i)
+					r.uleb();
+				break;
+			}
+		}
+	}
+	return true;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// Loaded modules
+
+struct __LoadedModule {
+	ModuleInfo module;
+	ElfImage* image = nullptr; // Null if the file could not be opened
+	bool opened = false;
+};
+
+static std::mutex gElfLock{};
+static auto& gElfModules = *new std::vector<__LoadedModule>(); // Outlives static destructors
+
+std::vector<ModuleInfo> profiler::elf::EnumerateModules() {
+	std::vector<ModuleInfo> modules;
+	dl_iterate_phdr([](dl_phdr_info* info, size_t, void* data) -> int {
+		ModuleInfo module;
+		module.bias = info->dlpi_addr;
+		unsigned long long beg = ULLONG_MAX;
+		unsigned long long end = 0;
+		for (int i = 0; i < info->dlpi_phnum; ++i) {
+			const ElfW(Phdr)& phdr = info->dlpi_phdr[i];
+			if (phdr.p_type == PT_LOAD) {
+				beg = std::min<unsigned long long>(beg, info->dlpi_addr + phdr.p_vaddr);
+				end = std::max<unsigned long long>(end, info->dlpi_addr + phdr.p_vaddr + phdr.p_memsz);
+			}
+			else if (phdr.p_type == PT_NOTE && module.buildId.empty())
+				module.buildId = __FindBuildId((const unsigned char*)(info->dlpi_addr + phdr.p_vaddr), phdr.p_memsz);
+		}
+		if (beg >= end) return 0;
+		module.base = beg;
+		module.size = end - beg;
+
+		// The main program has no name
+		if (info->dlpi_name != nullptr && info->dlpi_name[0] != '\0')
+			module.path = info->dlpi_name;
+		else {
+			char path[PATH_MAX] = { '\0' };
+			const ssize_t len = readlink("/proc/self/exe", path, sizeof(path) - 1);
+			module.path = len > 0 ? std::string(path, (size_t)len) : std::string();
+		}
+		((std::vector<ModuleInfo>*)data)->push_back(std::move(module));
+		return 0;
+	}, &modules);
+	return modules;
+}
+
+// Refresh the module list (modules may come and go through 'dlopen' / 'dlclose')
+static void __RescanModules() {
+	for (ModuleInfo& module : EnumerateModules()) {
+		auto it = std::find_if(gElfModules.begin(), gElfModules.end(), [&](const __LoadedModule& loaded) {
+			return loaded.module.bias == module.bias && loaded.module.path == module.path;
+		});
+		if (it == gElfModules.end())
+			gElfModules.push_back({ std::move(module) });
+	}
+}
+
+static __LoadedModule* __FindModule(unsigned long long addr) {
+	// Newest first: an unloaded module may have left a stale entry on the same range
+	for (auto it = gElfModules.rbegin(); it != gElfModules.rend(); ++it)
+		if (addr - it->module.base < it->module.size)
+			return &*it;
+	return nullptr;
+}
+
+static ElfImage* __OpenImage(__LoadedModule& loaded) {
+	if (!loaded.opened) {
+		loaded.opened = true;
+		ElfImage* image = new ElfImage();
+		if (!loaded.module.path.empty() && image->open(loaded.module.path.c_str()))
+			loaded.image = image;
+		else
+			delete image;
+	}
+	return loaded.image;
+}
+
+void profiler::elf::Demangle(const char* name, char* buffer, size_t size) {
+	int status = -1;
+	char* demangled = strncmp(name, "_Z", 2) == 0 ? abi::__cxa_demangle(name, nullptr, nullptr, &status) : nullptr;
+	snprintf(buffer, size, "%s", status == 0 && demangled != nullptr ? demangled : name);
+	free(demangled);
+}
+
+bool profiler::elf::Resolve(FuncID func, FuncInfo& info) {
+	std::lock_guard<std::mutex> lock(gElfLock);
+	//////////////////////////////////////////////////////////////////////////////
+	// 1. Owning module (rescan once: it may have been loaded after the last scan)
+	const unsigned long long addr = (unsigned long long)func;
+	__LoadedModule* loaded = __FindModule(addr);
+	if (loaded == nullptr) {
+		__RescanModules();
+		loaded = __FindModule(addr);
+	}
+	ElfImage* image = loaded != nullptr ? __OpenImage(*loaded) : nullptr;
+	if (image == nullptr) return false;
+
+	//////////////////////////////////////////////////////////////////////////////
+	// 2. Symbol (link-time address, i.e. without the load bias)
+	const unsigned long long vaddr = addr - loaded->module.bias;
+	const ElfSymbol* symbol = image->findSymbol(vaddr);
+	if (symbol == nullptr) return false;
+	char funcName[1024] = { '\0' };
+	Demangle(symbol->name, funcName, sizeof(funcName));
+
+	//////////////////////////////////////////////////////////////////////////////
+	// 3. Line Info (fall back to the module path without debug info)
+	const char* fileName = loaded->module.path.c_str();
+	int fileLine = 0;
+	image->findLine(vaddr, fileName, fileLine);
+
+	info.id = func;
+	info.fileLine = fileLine;
+	__SetFuncInfoNames(info, funcName, symbol->name, fileName);
+	return true;
+}
+
+void profiler::elf::EnumerateFunctions(std::vector<FuncID>& out) {
+	std::lock_guard<std::mutex> lock(gElfLock);
+	__RescanModules();
+	for (__LoadedModule& loaded : gElfModules) {
+		const ElfImage* image = __OpenImage(loaded);
+		if (image == nullptr) continue;
+		for (const ElfSymbol& symbol : image->symbols()) {
+			const unsigned long long addr = loaded.module.bias + symbol.addr;
+			if (addr - loaded.module.base < loaded.module.size)
+				out.push_back((FuncID)addr);
+		}
+	}
+}
+
+void profiler::elf::EnumerateSymbols(std::vector<__SymbolEntry>& out) {
+	std::lock_guard<std::mutex> lock(gElfLock);
+	__RescanModules();
+	char funcName[1024] = { '\0' };
+	for (__LoadedModule& loaded : gElfModules) {
+		ElfImage* image = __OpenImage(loaded);
+		if (image == nullptr) continue;
+		out.reserve(out.size() + image->symbols().size());
+		for (const ElfSymbol& symbol : image->symbols()) {
+			const unsigned long long addr = loaded.module.bias + symbol.addr;
+			if (addr - loaded.module.base >= loaded.module.size) continue;
+			Demangle(symbol.name, funcName, sizeof(funcName));
+			const char* fileName = loaded.module.path.c_str();
+			int fileLine = 0;
+			image->findLine(symbol.addr, fileName, fileLine);
+
+			__SymbolEntry entry{ {}, symbol.size };
+			entry.info.id = (FuncID)addr;
+			entry.info.fileLine = fileLine;
+			__SetFuncInfoNames(entry.info, funcName, symbol.name, fileName);
+			out.push_back(entry);
+		}
+	}
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+#include "profilerlib.hpp"
+
+#include <string>
+#include <vector>
+
+//////////////////////////////////////////////////////////////////////////////
+// Native ELF / DWARF symbolizer (Linux only, not part of the public API).
+// Function names come from '.symtab' (or '.dynsym' when stripped) and file /
+// line from the '.debug_line' programs, read straight from the files on disk.
+// Every address handled by an 'ElfImage' is a link-time virtual address:
+// runtime addresses need the module load bias subtracted first (PIE / ASLR).
+
+namespace profiler::elf {
+
+	struct ElfSymbol {
+		unsigned long long addr = 0;
+		unsigned long long size = 0;
+		const char* name = nullptr; // Mangled, points into the mapped file
+	};
+
+	struct ElfLine {
+		unsigned long long addr = 0;
+		unsigned int file = 0; // Index into the image file table
+		unsigned int line = 0; // 0 marks the end of a sequence
+	};
+
+	// An ELF file mapped (read-only) in memory.
+	class ElfImage {
+	public:
+		ElfImage() = default;
+		~ElfImage();
+		ElfImage(const ElfImage&) = delete;
+		ElfImage& operator=(const ElfImage&) = delete;
+
+	public:
+		bool open(const char* path);
+		const ElfSymbol* findSymbol(unsigned long long addr) const;
+		bool findLine(unsigned long long addr, const char*& file, int& line); // Parses '.debug_line' on first call
+
+		const std::vector<ElfSymbol>& symbols() const { return _symbols; }
+		const std::string& path() const { return _path; }
+		const std::string& buildId() const { return _buildId; }
+
+	private:
+		struct Section { const unsigned char* data = nullptr; size_t size = 0; };
+
+		bool __LoadSections();
+		void __LoadSymbols(const Section& symtab, const Section& strtab);
+		void __LoadLines();
+		bool __ParseLineUnit(const unsigned char*& p, const unsigned char* end);
+
+	private:
+		std::string _path;
+		std::string _buildId;
+		const unsigned char* _data = nullptr;
+		size_t _size = 0;
+		std::vector<ElfSymbol> _symbols;
+		std::vector<ElfLine> _lines;
+		std::vector<const char*> _files; // Interned, see '__InternString'
+		Section _debugLine, _debugLineStr, _debugStr;
+		ElfImage* _debugImage = nullptr; // Separate debug info ('/usr/lib/debug/.build-id/..')
+		bool _linesLoaded = false;
+	};
+
+	// Snapshot of the loaded modules through 'dl_iterate_phdr' (no file is opened).
+	std::vector<ModuleInfo> EnumerateModules();
+	// Resolve 'func' against the loaded modules. False if no symbol covers it.
+	bool Resolve(FuncID func, FuncInfo& info);
+	// Runtime address of every function symbol of the loaded modules.
+	void EnumerateFunctions(std::vector<FuncID>& out);
+	// Every function symbol of the loaded modules, resolved (names demangled, file / line looked up).
+	void EnumerateSymbols(std::vector<__SymbolEntry>& out);
+	// Demangle 'name' into 'buffer' (copied verbatim if not a C++ symbol).
+	void Demangle(const char* name, char* buffer, size_t size);
+}
@@ -0,0 +1,96 @@
+#include "profilerlib.hpp"
+#include "profilerlib_elf.hpp"
+
+#include <dlfcn.h>
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <cstdio>
+#include <cstring>
+
+#define NOINSTRUMENT __attribute__(( no_instrument_function ))
+#define HOOKAPI __attribute__(( visibility("default") ))
+
+//////////////////////////////////////////////////////////////////////////////
+// https://gcc.gnu.org/onlinedocs/gcc/Instrumentation-Options.html
+// Equivalent of '_penter' / '_pexit' (see 'hooks.asm') for code compiled
+// with '-finstrument-functions'. They must never be instrumented themselves.
+
+extern "C" {
+	HOOKAPI NOINSTRUMENT void __cyg_profile_func_enter(void* func, void* caller);
+	HOOKAPI NOINSTRUMENT void __cyg_profile_func_exit(void* func, void* caller);
+}
+
+void __cyg_profile_func_enter(void* func, [[maybe_unused]] void* caller) {
+	PEnter(func);
+}
+
+void __cyg_profile_func_exit([[maybe_unused]] void* func, [[maybe_unused]] void* caller) {
+	PExit(profiler::EmptyFuncID);
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+bool profiler::__GetFuncInfo(FuncID func, FuncInfo& info) {
+	// Native resolver first (file / line, static functions), 'dladdr' as a fallback
+	if (elf::Resolve(func, info))
+		return true;
+
+	char funcName[1024] = { {'\0'} };
+	char funcNameExt[1024] = { {'\0'} };
+	char fileName[1024] = { {'\0'} };
+
+	//////////////////////////////////////////////////////////////////////////////
+	// https://man7.org/linux/man-pages/man3/dladdr.3.html
+	// 1. Retrieve Symbol Info (needs '-rdynamic' for symbols inside the executable)
+	Dl_info dlInfo{};
+	bool resolved = dladdr(func, &dlInfo) && dlInfo.dli_sname != nullptr;
+	if (!resolved) {
+		snprintf(funcNameExt, sizeof(funcNameExt), "dladdr Error (%p)", func);
+		snprintf(funcName, sizeof(funcName), "dladdr Error (%p)", func);
+	}
+	else {
+		snprintf(funcNameExt, sizeof(funcNameExt), "%s", dlInfo.dli_sname);
+		//////////////////////////////////////////////////////////////////////////////
+		// 2. Demangled name
+		elf::Demangle(dlInfo.dli_sname, funcName, sizeof(funcName));
+	}
+
+	//////////////////////////////////////////////////////////////////////////////
+	// 3. Retrieve Line Info (not available through 'dladdr': use the module path)
+	if (dlInfo.dli_fname != nullptr)
+		snprintf(fileName, sizeof(fileName), "%s", dlInfo.dli_fname);
+	else
+		snprintf(fileName, sizeof(fileName), "dladdr Error (%p)", func);
+	info.fileLine = 0;
+
+	info.id = func;
+	__SetFuncInfoNames(info, funcName, funcNameExt, fileName);
+	return resolved;
+}
+
+void profiler::__EnumerateModules(std::vector<ModuleInfo>& out) {
+	for (ModuleInfo& module : elf::EnumerateModules())
+		out.push_back(std::move(module));
+}
+
+void profiler::__EnumerateSymbols(std::vector<__SymbolEntry>& out) {
+	elf::EnumerateSymbols(out);
+}
+
+unsigned long long profiler::__GetCurrentThreadOSID() {
+#ifdef SYS_gettid
+	return (unsigned long long)syscall(SYS_gettid);
+#else
+	return (unsigned long long)pthread_self();
+#endif
+}
+
+void profiler::__LowerThreadPriority() {
+#ifdef SCHED_IDLE
+	// Only runs when the CPU would otherwise be idle
+	sched_param param{};
+	pthread_setschedparam(pthread_self(), SCHED_IDLE, &param);
+#endif
+}
@@ -0,0 +1,131 @@
+#include "profilerlib.hpp"
+
+#include <utility>
+
+profiler::FrameHistory::FrameHistory(size_t capacity, OverflowPolicy policy /*= OverflowPolicy::DropNewest*/) {
+	reserve(capacity, policy);
+}
+
+profiler::FrameHistory::FrameHistory(const FrameHistory& other) {
+	*this = other;
+}
+
+profiler::FrameHistory& profiler::FrameHistory::operator=(const FrameHistory& other) {
+	if (this == &other) return *this;
+	reserve(other._capacity, other._policy);
+	for (size_t i = 0; i < other._size; ++i)
+		__Push(other.__At(i));
+	_dropped = other._dropped;
+	_baseTime = other._baseTime;
+	_lastTime = other._lastTime;
+	return *this;
+}
+
+profiler::FrameHistory::FrameHistory(FrameHistory&& other) noexcept {
+	*this = std::move(other);
+}
+
+profiler::FrameHistory& profiler::FrameHistory::operator=(FrameHistory&& other) noexcept {
+	if (this == &other) return *this;
+	// Every field is reset: a moved-from history must not index chunks it no longer owns
+	_chunks = std::exchange(other._chunks, {});
+	_capacity = std::exchange(other._capacity, 0);
+	_lazyCapacity = std::exchange(other._lazyCapacity, 0);
+	_mask = std::exchange(other._mask, 0);
+	_head = std::exchange(other._head, 0);
+	_size = std::exchange(other._size, 0);
+	_dropped = std::exchange(other._dropped, 0);
+	_baseTime = std::exchange(other._baseTime, 0);
+	_lastTime = std::exchange(other._lastTime, 0);
+	_policy = std::exchange(other._policy, OverflowPolicy::DropNewest);
+	return *this;
+}
+
+void profiler::FrameHistory::reserve(size_t capacity, OverflowPolicy policy) {
+	//////////////////////////////////////////////////////////////////////////////
+	// 1. Round up capacity (power of 2, so that wrapping is just a mask)
+	size_t rounded = FrameHistoryChunkSize;
+	while (rounded < capacity) rounded *= 2;
+	if (capacity == 0) rounded = 0;
+
+	//////////////////////////////////////////////////////////////////////////////
+	// 2. Allocate chunks (all of them, upfront)
+	_chunks.resize(rounded / FrameHistoryChunkSize);
+	for (auto& chunk : _chunks)
+		if (!chunk) chunk = std::make_unique<Chunk>();
+
+	_capacity = rounded;
+	_lazyCapacity = 0;
+	_mask = (rounded == 0) ? 0 : rounded - 1;
+	_policy = policy;
+	clear();
+}
+
+profiler::FrameHistory profiler::FrameHistory::Lazy(size_t capacity, OverflowPolicy policy) {
+	FrameHistory history{};
+	history._lazyCapacity = capacity;
+	history._policy = policy;
+	return history;
+}
+
+void profiler::FrameHistory::clear() noexcept {
+	_head = 0;
+	_size = 0;
+	_dropped = 0;
+	// The first event is always preceded by a time escape (its delta from 0 doesn't fit)
+	_baseTime = 0;
+	_lastTime = 0;
+}
+
+bool profiler::FrameHistory::__Overflow() noexcept {
+	if (_capacity == 0 && _lazyCapacity != 0) {
+		reserve(_lazyCapacity, _policy);
+		return true;
+	}
+	_dropped++;
+	if (_capacity == 0 || _policy == OverflowPolicy::DropNewest)
+		return false;
+	// DropOldest: free the oldest slot, moving the decoding base past it
+	FrameHistoryEvent oldest = __At(0);
+	if ((oldest & EventKindMask) == EventTime)
+		_baseTime = oldest & EventPayloadMask;
+	else if ((oldest & EventKindMask) == EventEnter)
+		_baseTime += (oldest & EventPayloadMask) >> 32;
+	else
+		_baseTime += oldest & EventPayloadMask;
+	_head = (_head + 1) & _mask;
+	_size--;
+	return true;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+profiler::FrameHistory::const_iterator::const_iterator(const FrameHistory* history, size_t index, TimeStamp time) :
+	_history(history), _index(index), _entry({ .id = EmptyFuncID, .time = time })
+{
+	__Decode();
+}
+
+void profiler::FrameHistory::const_iterator::__Decode() {
+	// Time escapes only move the clock: skip them
+	while (_index < _history->_size) {
+		FrameHistoryEvent ev = _history->__At(_index);
+		FrameHistoryEvent kind = ev & EventKindMask;
+		FrameHistoryEvent payload = ev & EventPayloadMask;
+		if (kind == EventTime) {
+			_entry.time = payload;
+			++_index;
+			continue;
+		}
+		if (kind == EventEnter) {
+			_entry.time += payload >> 32;
+			_funcIndex = (FuncIndex)(payload & 0xFFFFFFFF);
+			_entry.id = __GetFuncIDFromIndex(_funcIndex);
+		}
+		else {
+			_entry.time += payload;
+			_entry.id = EmptyFuncID;
+		}
+		return;
+	}
+}
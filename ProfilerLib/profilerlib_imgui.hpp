@@ -14,9 +14,9 @@ namespace profiler {
 	namespace internal {
 		bool __DrawFuncRect(
 			profiler::FuncID func,
-			DeltaUs funcOffset,
-			DeltaUs funcDuration,
-			DeltaUs timeFrameDuration,
+			DeltaNs funcOffset,
+			DeltaNs funcDuration,
+			DeltaNs timeFrameDuration,
 			float totalW,
 			float startY,
 			int funcLevel,
@@ -28,9 +28,9 @@ namespace profiler {
 
 		void __DrawTimeLines(
 			int timeLinesMax,
-			profiler::DeltaUs timeRounding,
-			profiler::DeltaUs timeFrameDuration,
-			profiler::DeltaUs timeFrameBeg,
+			profiler::DeltaNs timeRounding,
+			profiler::DeltaNs timeFrameDuration,
+			profiler::DeltaNs timeFrameBeg,
 			float totalW,
 			float lineStartY,
 			float lineHeight,
@@ -46,7 +46,7 @@ void profiler::ImGuiRenderFrameHistory(
 	const FrameHistory& history,
 	int screenW, int screenH
 ) {
-	if (history.size() == 0) return;
+	if (history.empty()) return;
 
 	///////////////////////////////////////////////////////////////
 	// Disable profiler
@@ -54,7 +54,10 @@ void profiler::ImGuiRenderFrameHistory(
 
 	///////////////////////////////////////////////////////////////
 	// State
-	static int selectedHistoryIndexBeg = -1, selectedHistoryIndexEnd = -1;
+	static bool selected = false;
+	static FrameHistoryEntry selectedBeg{}, selectedEnd{}; // selected invocation
+	static TimeStamp selectedFrameBeg = 0;
+	static std::vector<FuncID> selectedStack{}; // callers of the selected invocation (outermost first)
 	static float from = 0, to = 1; // selection range
 
 	///////////////////////////////////////////////////////////////
@@ -72,8 +75,7 @@ void profiler::ImGuiRenderFrameHistory(
 			// On appearing
 			if (ImGui::IsWindowAppearing()) {
 				ImGui::SetWindowFocus();
-				selectedHistoryIndexBeg = -1;
-				selectedHistoryIndexEnd = -1;
+				selected = false;
 				from = 0;
 				to = 1;
 			}
@@ -85,9 +87,9 @@ void profiler::ImGuiRenderFrameHistory(
 			ImGuiIO& io = ImGui::GetIO();
 			static float chartLevelH = 50.f;
 			static int chartMaxLevel = 12;
-			static const char* statsTimeUnit[] = { "us", "ms", "s" };
-			static float statsTimeUnitConv[] = { 1, 1'000, 1'000'000 };
-			static int statsTimeUnitIndex = 0;
+			static const char* statsTimeUnit[] = { "ns", "us", "ms", "s" };
+			static double statsTimeUnitConv[] = { 1, 1'000, 1'000'000, 1'000'000'000 };
+			static int statsTimeUnitIndex = 1;
 
 			///////////////////////////////////////////////////////////////
 			// Header
@@ -95,11 +97,12 @@ void profiler::ImGuiRenderFrameHistory(
 				if (ImGui::BeginMenu("Options")) {
 					ImGui::SliderFloat("Plot event height", &chartLevelH, 5, 100, "%.0f", ImGuiSliderFlags_AlwaysClamp);
 					ImGui::SliderInt("Plot max depth", &chartMaxLevel, 2, 32, "%d", ImGuiSliderFlags_AlwaysClamp);
-					ImGui::Combo("Stats unit", &statsTimeUnitIndex, statsTimeUnit, 3);
+					ImGui::Combo("Stats unit", &statsTimeUnitIndex, statsTimeUnit, 4);
 					ImGui::EndMenu();
 				}
 				if (ImGui::BeginMenu("Data")) {
-					ImGui::Text("FrameEvent count: %d", history.size());
+					ImGui::Text("FrameEvent count: %zu", history.size());
+					ImGui::Text("FrameEvent dropped: %zu", history.dropped());
 					ImGui::EndMenu();
 				}
 				ImGui::EndMenuBar();
@@ -118,9 +121,9 @@ void profiler::ImGuiRenderFrameHistory(
 				drawList->AddRectFilled(bgRectMin, bgRectMax, IM_COL32(128, 128, 128, 64), 0);
 
 				// 2. Frame vars
-				TimeStamp frameBeg = history[0].time;
-				TimeStamp frameEnd = history[history.size() - 1].time;
-				DeltaUs frameDuration = ComputeDelta(frameBeg, frameEnd);
+				TimeStamp frameBeg = history.begin()->time;
+				TimeStamp frameEnd = history.backTime();
+				DeltaNs frameDuration = ComputeDeltaNs(frameBeg, frameEnd);
 
 				// 3. Events Rects
 				static std::stack<profiler::FrameHistoryEntry> stack{}; // exploration stack
@@ -130,12 +133,13 @@ void profiler::ImGuiRenderFrameHistory(
 						stack.push(ev);
 					}
 					else {
-						const auto& begEvent = stack.top();
+						if (stack.empty()) continue; // enter dropped (OverflowPolicy::DropOldest)
+						const auto begEvent = stack.top();
 						stack.pop();
 						int level = (int)stack.size();
 						if (level < maxLevel) {
-							DeltaUs off = ComputeDelta(frameBeg, begEvent.time);
-							DeltaUs dur = ComputeDelta(begEvent.time, ev.time);
+							DeltaNs off = ComputeDeltaNs(frameBeg, begEvent.time);
+							DeltaNs dur = ComputeDeltaNs(begEvent.time, ev.time);
 							internal::__DrawFuncRect(
 								begEvent.id, off, dur, frameDuration,
 								w, starty, level, levelH,
@@ -146,7 +150,7 @@ void profiler::ImGuiRenderFrameHistory(
 				}
 
 				// 4. Time lines
-				internal::__DrawTimeLines(6, 1000, frameDuration, 0, w, starty, maxLevel * levelH);
+				internal::__DrawTimeLines(6, 1'000'000, frameDuration, 0, w, starty, maxLevel * levelH);
 
 				// 5. Selection Rect
 				static float oldX = 0; // selection drag origin x
@@ -215,30 +219,29 @@ void profiler::ImGuiRenderFrameHistory(
 				drawList->AddRectFilled(bgRectMin, bgRectMax, IM_COL32(128, 128, 128, 64), 0);
 
 				// 2. Frame vars (zoomed)
-				TimeStamp frameBeg = history[0].time;
-				TimeStamp frameEnd = history[history.size() - 1].time;
-				DeltaUs frameDuration = ComputeDelta(frameBeg, frameEnd);
-				DeltaUs zoomBegUs = (DeltaUs)(frameDuration * selFrom);
-				DeltaUs zoomEndUs = (DeltaUs)(frameDuration * selTo);
-				DeltaUs zoomDuration = zoomEndUs - zoomBegUs;
+				TimeStamp frameBeg = history.begin()->time;
+				TimeStamp frameEnd = history.backTime();
+				DeltaNs frameDuration = ComputeDeltaNs(frameBeg, frameEnd);
+				DeltaNs zoomBegNs = (DeltaNs)(frameDuration * (double)selFrom);
+				DeltaNs zoomEndNs = (DeltaNs)(frameDuration * (double)selTo);
+				DeltaNs zoomDuration = zoomEndNs - zoomBegNs;
 
 				// 3. Events Rects
-				static std::stack<int> stack{}; // exploration stack
-				while (!stack.empty()) stack.pop();
-				for (int i = 0; i < history.size(); ++i) {
-					const auto& ev = history[i];
+				static std::vector<profiler::FrameHistoryEntry> stack{}; // exploration stack
+				stack.clear();
+				for (const auto& ev : history) {
 					if (ev.id != EmptyFuncID) {
-						stack.push(i);
+						stack.push_back(ev);
 					}
 					else {
-						int begEventIndex = stack.top(); stack.pop();
-						const auto& begEvent = history[begEventIndex];
+						if (stack.empty()) continue; // enter dropped (OverflowPolicy::DropOldest)
+						const auto begEvent = stack.back(); stack.pop_back();
 						int level = (int)stack.size();
 						if (level < maxLevel) {
-							DeltaUs absOff = ComputeDelta(frameBeg, begEvent.time);
-							DeltaUs absDur = ComputeDelta(begEvent.time, ev.time);
-							DeltaUs relOff = absOff - zoomBegUs;
-							DeltaUs relDur = absDur;
+							DeltaNs absOff = ComputeDeltaNs(frameBeg, begEvent.time);
+							DeltaNs absDur = ComputeDeltaNs(begEvent.time, ev.time);
+							DeltaNs relOff = absOff - zoomBegNs;
+							DeltaNs relDur = absDur;
 							if (relOff < 0) {
 								relDur += relOff;
 								relOff = 0;
@@ -252,15 +255,20 @@ void profiler::ImGuiRenderFrameHistory(
 								true, true, true
 							);
 							if (clicked) {
-								selectedHistoryIndexBeg = begEventIndex;
-								selectedHistoryIndexEnd = i;
+								selected = true;
+								selectedBeg = begEvent;
+								selectedEnd = ev;
+								selectedFrameBeg = frameBeg;
+								selectedStack.clear();
+								for (const auto& caller : stack)
+									selectedStack.push_back(caller.id);
 							}
 						}
 					}
 				}
 
 				// 4. Time lines
-				internal::__DrawTimeLines(4, 100, zoomDuration, zoomBegUs, w, starty, maxLevel * levelH);
+				internal::__DrawTimeLines(4, 100'000, zoomDuration, zoomBegNs, w, starty, maxLevel * levelH);
 
 				// 5. Gestures
 				static float oldX = 0; // drag origin x
@@ -300,30 +308,31 @@ void profiler::ImGuiRenderFrameHistory(
 			///////////////////////////////////////////////////////////////
 			// Selected Func Info & Stats
 			{
-				if (selectedHistoryIndexBeg != -1 && selectedHistoryIndexEnd != -1) {
+				if (selected) {
 					///////////////////////////////////////////////////////////////
 					// Data
 					const char* timeUnit = statsTimeUnit[statsTimeUnitIndex];
-					float timeUnitConvFromUs = statsTimeUnitConv[statsTimeUnitIndex];
-					FuncID funcID = history[selectedHistoryIndexBeg].id;
+					double timeUnitConvFromNs = statsTimeUnitConv[statsTimeUnitIndex];
+					FuncID funcID = selectedBeg.id;
 					const auto& funcInfo = GetFuncInfo(funcID);
-					const auto& funcStats = GetFuncStats(funcID);
-					TimeStamp funcBeg = history[selectedHistoryIndexBeg].time;
-					TimeStamp funcEnd = history[selectedHistoryIndexEnd].time;
-					DeltaUs funcDur = ComputeDelta(funcBeg, funcEnd);
-					TimeStamp frameBeg = history[0].time;
-					TimeStamp frameEnd = history[history.size() - 1].time;
-					DeltaUs frameDur = ComputeDelta(frameBeg, frameEnd);
-					DeltaUs funcBegRel = ComputeDelta(frameBeg, funcBeg);
-					DeltaUs funcEndRel = ComputeDelta(frameBeg, funcEnd);
+					const auto& stats = GetStatsTable();
+					const FuncStats* funcStats = stats.find(funcID); // None in CaptureMode::History
+					TimeStamp funcBeg = selectedBeg.time;
+					TimeStamp funcEnd = selectedEnd.time;
+					DeltaNs funcDur = ComputeDeltaNs(funcBeg, funcEnd);
+					DeltaNs funcBegRel = ComputeDeltaNs(selectedFrameBeg, funcBeg);
+					DeltaNs funcEndRel = ComputeDeltaNs(selectedFrameBeg, funcEnd);
 
 					///////////////////////////////////////////////////////////////
 					// Display data
 					ImGui::SeparatorText("Selection");
-					if (ImGui::BeginTable("Table", 4, ImGuiTableFlags_Resizable | ImGuiTableFlags_Reorderable)) {
+					const int columnCount = (funcStats != nullptr) ? 4 : 3; // No Performance without stats
+					if (ImGui::BeginTable("Table", columnCount, ImGuiTableFlags_Resizable | ImGuiTableFlags_Reorderable)) {
 						///////////////////////////
+						int column = 0;
 						ImGui::TableSetupColumn("Source Code");
-						ImGui::TableSetupColumn("Performance");
+						if (funcStats != nullptr)
+							ImGui::TableSetupColumn("Performance");
 						ImGui::TableSetupColumn("Current Frame");
 						ImGui::TableSetupColumn("Stack Trace");
 						ImGui::TableHeadersRow();
@@ -331,50 +340,44 @@ void profiler::ImGuiRenderFrameHistory(
 
 						///////////////////////////
 						// Source Code
-						ImGui::TableSetColumnIndex(0);
+						ImGui::TableSetColumnIndex(column++);
 						ImGui::Text("%s", funcInfo.fileName);
 						ImGui::Text("%s", funcInfo.funcNameExt);
 						ImGui::Text("%s.%d", funcInfo.funcName, funcInfo.fileLine);
 
 						///////////////////////////
 						// Performance
-						ImGui::TableSetColumnIndex(1);
-						ImGui::Text("Max: %14.3f (%s)", funcStats.usMax / timeUnitConvFromUs, timeUnit);
-						ImGui::Text("Min: %14.3f (%s)", funcStats.usMin / timeUnitConvFromUs, timeUnit);
-						ImGui::Text("Avg: %14.3f (%s)", funcStats.usAvg / timeUnitConvFromUs, timeUnit);
-						ImGui::Text("Tot: %14.3f (%s)", funcStats.usTot / timeUnitConvFromUs, timeUnit);
-						ImGui::Text("#Calls: %12lld", funcStats.invocationCount);
+						if (funcStats != nullptr) {
+							ImGui::TableSetColumnIndex(column++);
+							ImGui::Text("Max: %14.3f (%s)", TicksToNs(funcStats->ticksMax) / timeUnitConvFromNs, timeUnit);
+							ImGui::Text("Min: %14.3f (%s)", TicksToNs(funcStats->ticksMin) / timeUnitConvFromNs, timeUnit);
+							ImGui::Text("Avg: %14.3f (%s)", TicksToNs(funcStats->ticksAvg()) / timeUnitConvFromNs, timeUnit);
+							ImGui::Text("Std: %14.3f (%s)", funcStats->ticksStddev() * GetClockNsPerTick() / timeUnitConvFromNs, timeUnit);
+							ImGui::Text("CV: %15.3f", funcStats->cv());
+							if (const LatencyHistogram* histogram = stats.findHistogram(funcID)) {
+								ImGui::Text("P50: %14.3f (%s)", TicksToNs(histogram->percentile(50.0)) / timeUnitConvFromNs, timeUnit);
+								ImGui::Text("P90: %14.3f (%s)", TicksToNs(histogram->percentile(90.0)) / timeUnitConvFromNs, timeUnit);
+								ImGui::Text("P99: %14.3f (%s)", TicksToNs(histogram->percentile(99.0)) / timeUnitConvFromNs, timeUnit);
+								ImGui::Text("P99.9: %12.3f (%s)", TicksToNs(histogram->percentile(99.9)) / timeUnitConvFromNs, timeUnit);
+							}
+							ImGui::Text("Tot: %14.3f (%s)", TicksToNs(funcStats->ticksTot) / timeUnitConvFromNs, timeUnit);
+							ImGui::Text("Self: %13.3f (%s)", TicksToNs(funcStats->ticksSelfTot) / timeUnitConvFromNs, timeUnit);
+							ImGui::Text("Incl: %13.3f (%s)", TicksToNs(funcStats->ticksCollapsedTot) / timeUnitConvFromNs, timeUnit);
+							ImGui::Text("#Calls: %12d", funcStats->invocationCount);
+						}
 
 						///////////////////////////
 						// Current Frame
-						ImGui::TableSetColumnIndex(2);
-						ImGui::Text("Beg: %14.3f (%s)", funcBegRel / timeUnitConvFromUs, timeUnit);
-						ImGui::Text("End: %14.3f (%s)", funcEndRel / timeUnitConvFromUs, timeUnit);
-						ImGui::Text("Dur: %14.3f (%s)", funcDur / timeUnitConvFromUs, timeUnit);
+						ImGui::TableSetColumnIndex(column++);
+						ImGui::Text("Beg: %14.3f (%s)", funcBegRel / timeUnitConvFromNs, timeUnit);
+						ImGui::Text("End: %14.3f (%s)", funcEndRel / timeUnitConvFromNs, timeUnit);
+						ImGui::Text("Dur: %14.3f (%s)", funcDur / timeUnitConvFromNs, timeUnit);
 
 						///////////////////////////
 						// Stack Trace
-						ImGui::TableSetColumnIndex(3);
-						static std::vector<int> funcStack{};
-						funcStack.clear();
-						int endcount = 0;
-						for (int i = selectedHistoryIndexBeg - 1; i >= 0; --i) {
-							const auto& ev = history[i];
-							if (ev.id == EmptyFuncID) {
-								endcount++;
-							}
-							else {
-								if (endcount > 0) {
-									endcount--;
-								}
-								else {
-									funcStack.push_back(i);
-								}
-							}
-						}
-						for (int i = (int)funcStack.size() - 1; i >= 0; --i) {
-							const auto& ev = history[funcStack[i]];
-							const auto& stackFuncInfo = GetFuncInfo(ev.id);
+						ImGui::TableSetColumnIndex(column++);
+						for (FuncID caller : selectedStack) {
+							const auto& stackFuncInfo = GetFuncInfo(caller);
 							ImGui::Text(">> %s.%d", stackFuncInfo.funcName, stackFuncInfo.fileLine);
 						}
 						ImGui::Text(">> %s.%d", funcInfo.funcName, funcInfo.fileLine);
@@ -395,9 +398,9 @@ void profiler::ImGuiRenderFrameHistory(
 
 bool profiler::internal::__DrawFuncRect(
 	profiler::FuncID func,
-	DeltaUs funcOffset,
-	DeltaUs funcDuration,
-	DeltaUs timeFrameDuration,
+	DeltaNs funcOffset,
+	DeltaNs funcDuration,
+	DeltaNs timeFrameDuration,
 	float totalW,
 	float startY,
 	int funcLevel,
@@ -407,11 +410,11 @@ bool profiler::internal::__DrawFuncRect(
 	bool returnClicked /*= false*/
 ) {
 	ImDrawList* drawList = ImGui::GetWindowDrawList();
-	float beg = (funcOffset) / (float)timeFrameDuration;
-	float end = (funcOffset + funcDuration) / (float)timeFrameDuration;
+	float beg = (float)((funcOffset) / (double)timeFrameDuration);
+	float end = (float)((funcOffset + funcDuration) / (double)timeFrameDuration);
 	end = std::max(end, 0.001f);
 	const auto& info = profiler::GetFuncInfo(func);
-	CRC32 hash = ComputeCRC32(info.funcName, (int)strlen(info.funcName));
+	CRC32 hash = ComputeCRC32(info.funcName, (int)info.funcNameLen);
 	ImU32 color = IM_COL32((hash & 0x000000ff), (hash & 0x0000ff00), (hash & 0x00ff0000), 255);
 	ImVec2 posmin(beg * totalW, startY + (funcLevel + 0) * levelHeight);
 	ImVec2 posmax(end * totalW, startY + (funcLevel + 1) * levelHeight);
@@ -437,9 +440,9 @@ bool profiler::internal::__DrawFuncRect(
 
 void profiler::internal::__DrawTimeLines(
 	int timeLinesMax,
-	profiler::DeltaUs timeRounding,
-	profiler::DeltaUs timeFrameDuration,
-	profiler::DeltaUs timeFrameBeg,
+	profiler::DeltaNs timeRounding,
+	profiler::DeltaNs timeFrameDuration,
+	profiler::DeltaNs timeFrameBeg,
 	float totalW,
 	float lineStartY,
 	float lineHeight,
@@ -448,16 +451,16 @@ void profiler::internal::__DrawTimeLines(
 ) {
 	ImDrawList* drawList = ImGui::GetWindowDrawList();
 	static char buff[64] = { {'\0'} };
-	DeltaUs timeLinesCount = (timeFrameDuration / timeRounding) + 1;
-	profiler::DeltaUs timeRoundingRel = timeRounding * ((timeLinesCount / timeLinesMax) + 1);
-	profiler::DeltaUs timeFrameBegRel = timeFrameBeg - (timeFrameBeg % timeRoundingRel);
+	DeltaNs timeLinesCount = (timeFrameDuration / timeRounding) + 1;
+	profiler::DeltaNs timeRoundingRel = timeRounding * ((timeLinesCount / timeLinesMax) + 1);
+	profiler::DeltaNs timeFrameBegRel = timeFrameBeg - (timeFrameBeg % timeRoundingRel);
 	for (int i = 0; i < timeLinesCount; ++i) {
-		profiler::DeltaUs timeUs = timeFrameBegRel + timeRoundingRel * (i + 1LL);
-		float timePercentage = (timeUs - timeFrameBeg) / (float)timeFrameDuration;
+		profiler::DeltaNs timeNs = timeFrameBegRel + timeRoundingRel * (i + 1LL);
+		float timePercentage = (float)((timeNs - timeFrameBeg) / (double)timeFrameDuration);
 		ImVec2 lineMin = ImVec2(timePercentage * totalW, lineStartY);
 		ImVec2 lineMax = ImVec2(timePercentage * totalW, lineStartY + lineHeight);
 		drawList->AddLine(lineMin, lineMax, lineColor);
-		int n = sprintf_s(buff, textFormat, timeUs / 1'000.f);
+		int n = sprintf_s(buff, textFormat, timeNs / 1'000'000.f);
 		ImVec2 textSize = ImGui::CalcTextSize(buff, buff + n);
 		ImVec2 textPos = ImVec2(lineMin.x - textSize.x / 2, lineMin.y - textSize.y);
 		ImGui::RenderText(textPos, buff, buff + n);
@@ -0,0 +1,123 @@
+#include "profilerlib.hpp"
+
+#include <atomic>
+#include <cstdio>
+#include <mutex>
+
+//////////////////////////////////////////////////////////////////////////////
+// Process-wide FuncID <=> FuncIndex mapping.
+// Indices are handed out in order of first appearance and never change.
+//
+// FuncID -> FuncIndex: open-addressing (linear probing) table. Lookups are lock-free,
+// insertions are serialized. When the table gets half full, a twice as big copy is published;
+// older tables are kept alive (readers may still be probing them) and only cause a locked re-check.
+// FuncIndex -> FuncID: fixed-size chunks, so that readers never race with growth.
+
+struct FuncIndexSlot {
+	std::atomic<profiler::FuncID> func;
+	profiler::FuncIndex index;
+};
+
+struct FuncIndexTable {
+	size_t mask;
+	FuncIndexSlot* slots;
+};
+
+static constexpr size_t gFuncTableInitialSize = 1 << 12;
+
+static std::mutex gFuncInternLock{};
+static std::atomic<FuncIndexTable*> gFuncTable = nullptr;
+static std::atomic<profiler::FuncID*> gFuncIDs[profiler::__FuncChunkCount] = {};
+static std::atomic<profiler::FuncIndex> gFuncCount = 0;
+
+static inline size_t __HashFuncID(profiler::FuncID func) {
+	// Fibonacci hashing (addresses are aligned and clustered)
+	return (size_t)(((unsigned long long)func * 0x9E3779B97F4A7C15ULL) >> 17);
+}
+
+static bool __Probe(const FuncIndexTable* table, profiler::FuncID func, profiler::FuncIndex& index) {
+	for (size_t i = __HashFuncID(func) & table->mask; ; i = (i + 1) & table->mask) {
+		profiler::FuncID slot = table->slots[i].func.load(std::memory_order_acquire);
+		if (slot == func) {
+			index = table->slots[i].index;
+			return true;
+		}
+		if (slot == profiler::EmptyFuncID) return false;
+	}
+}
+
+static void __Insert(FuncIndexTable* table, profiler::FuncID func, profiler::FuncIndex index) {
+	for (size_t i = __HashFuncID(func) & table->mask; ; i = (i + 1) & table->mask) {
+		if (table->slots[i].func.load(std::memory_order_relaxed) == profiler::EmptyFuncID) {
+			table->slots[i].index = index;
+			table->slots[i].func.store(func, std::memory_order_release);
+			return;
+		}
+	}
+}
+
+static FuncIndexTable* __NewTable(size_t size) {
+	FuncIndexTable* table = new FuncIndexTable{ .mask = size - 1, .slots = new FuncIndexSlot[size] };
+	for (size_t i = 0; i < size; ++i) {
+		table->slots[i].func.store(profiler::EmptyFuncID, std::memory_order_relaxed);
+		table->slots[i].index = 0;
+	}
+	return table;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+bool profiler::__FindFuncIndex(FuncID func, FuncIndex& index) {
+	const FuncIndexTable* table = gFuncTable.load(std::memory_order_acquire);
+	return (table != nullptr) && __Probe(table, func, index);
+}
+
+profiler::FuncIndex profiler::__InternFuncID(FuncID func) {
+	//////////////////////////////////////////////////////////////////////////////
+	// 1. Lock-free lookup
+	FuncIndex index = 0;
+	if (__FindFuncIndex(func, index)) return index;
+
+	//////////////////////////////////////////////////////////////////////////////
+	// 2. Locked re-check (the table may have been replaced meanwhile)
+	std::lock_guard<std::mutex> lock(gFuncInternLock);
+	FuncIndexTable* table = gFuncTable.load(std::memory_order_relaxed);
+	if (table != nullptr && __Probe(table, func, index)) return index;
+
+	//////////////////////////////////////////////////////////////////////////////
+	// 3. Assign the next index
+	index = gFuncCount.load(std::memory_order_relaxed);
+	size_t chunk = index / __FuncChunkSize;
+	if (chunk >= __FuncChunkCount) {
+		fprintf(stderr, "Profiling error: too many functions (%u)\n", index);
+		return 0;
+	}
+	if (gFuncIDs[chunk].load(std::memory_order_relaxed) == nullptr)
+		gFuncIDs[chunk].store(new FuncID[__FuncChunkSize](), std::memory_order_release);
+	gFuncIDs[chunk].load(std::memory_order_relaxed)[index % __FuncChunkSize] = func;
+
+	//////////////////////////////////////////////////////////////////////////////
+	// 4. Grow (keep load factor <= 0.5) and insert
+	if (table == nullptr || (size_t)(index + 1) * 2 > table->mask + 1) {
+		size_t size = (table == nullptr) ? gFuncTableInitialSize : (table->mask + 1) * 2;
+		FuncIndexTable* bigger = __NewTable(size);
+		for (FuncIndex i = 0; i < index; ++i)
+			__Insert(bigger, __GetFuncIDFromIndex(i), i);
+		table = bigger;
+	}
+	__Insert(table, func, index);
+	gFuncTable.store(table, std::memory_order_release);
+	gFuncCount.store(index + 1, std::memory_order_release);
+	// Prefetch: symbols are resolved in the background before anyone asks
+	__EnqueueFuncIndex(index);
+	return index;
+}
+
+profiler::FuncIndex profiler::__GetFuncCount() {
+	return gFuncCount.load(std::memory_order_acquire);
+}
+
+profiler::FuncID profiler::__GetFuncIDFromIndex(FuncIndex index) {
+	FuncID* chunk = gFuncIDs[index / __FuncChunkSize].load(std::memory_order_acquire);
+	return (chunk == nullptr) ? EmptyFuncID : chunk[index % __FuncChunkSize];
+}
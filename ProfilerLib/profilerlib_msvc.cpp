@@ -3,6 +3,10 @@
 #define WIN32_LEAN_AND_MEAN
 #include <windows.h>
 #include <imagehlp.h>
+#include <psapi.h>
+#include <cstdio>
+#include <cstring>
+#include <string>
 
 #define error() __Error(__FUNCSIG__, __LINE__)
 
@@ -10,19 +14,21 @@ bool __Init(HMODULE hModule);
 bool __Exit();
 bool __Error(const char* func, const int line);
 
+// The symbol handler is initialized on the first resolution (never with SymbolMode::Deferred)
+static HMODULE gModule = NULL;
+static bool gSymbolsInitialized = false;
+
 BOOL APIENTRY DllMain(HMODULE hModule, DWORD reason, LPVOID lpvReserved) {
 	//////////////////////////////////////////////////////////////////////////////
 	// https://learn.microsoft.com/en-us/windows/win32/dlls/dllmain
 
 	// 
 	if (reason == DLL_PROCESS_ATTACH) {
-		if (!__Init(hModule)) {
-			return FALSE;
-		}
+		gModule = hModule;
 	}
 
 	// 
-	if (reason == DLL_PROCESS_DETACH) {
+	if (reason == DLL_PROCESS_DETACH && gSymbolsInitialized) {
 		if (!__Exit()) {
 			return FALSE;
 		}
@@ -83,7 +89,14 @@ bool __Error(const char* func, const int line) {
 	return false;
 }
 
-void profiler::__GetFuncInfo(FuncID func, FuncInfo& info) {
+bool profiler::__GetFuncInfo(FuncID func, FuncInfo& info) {
+	// Called with the resolver lock held
+	if (!gSymbolsInitialized)
+		gSymbolsInitialized = __Init(gModule != NULL ? gModule : GetModuleHandleA(NULL)); // NULL when linked statically
+
+	char funcName[1024] = { {'\0'} };
+	char funcNameExt[1024] = { {'\0'} };
+	char fileName[1024] = { {'\0'} };
 
 	//////////////////////////////////////////////////////////////////////////////
 	// https://learn.microsoft.com/en-us/windows/win32/debug/retrieving-symbol-information-by-address
@@ -93,13 +106,14 @@ void profiler::__GetFuncInfo(FuncID func, FuncInfo& info) {
 	PSYMBOL_INFO pSymbolInfo = (PSYMBOL_INFO)buffer;
 	pSymbolInfo->SizeOfStruct = sizeof(SYMBOL_INFO);
 	pSymbolInfo->MaxNameLen = MAX_SYM_NAME - 1;
-	if (!SymFromAddr(GetCurrentProcess(), (DWORD64)func, &dwDisplacement1, pSymbolInfo)) {
-		sprintf_s(info.funcNameExt, "SymFromAddr Error (%d)", GetLastError());
-		sprintf_s(info.funcName, "SymFromAddr Error (%d)", GetLastError());
+	bool resolved = SymFromAddr(GetCurrentProcess(), (DWORD64)func, &dwDisplacement1, pSymbolInfo) != FALSE;
+	if (!resolved) {
+		sprintf_s(funcNameExt, "SymFromAddr Error (%d)", GetLastError());
+		sprintf_s(funcName, "SymFromAddr Error (%d)", GetLastError());
 		// error();
 	}
 	else {
-		strcpy_s(info.funcNameExt, pSymbolInfo->Name);
+		strcpy_s(funcNameExt, pSymbolInfo->Name);
 		//////////////////////////////////////////////////////////////////////////////
 		// 2. Undecorated name
 		CHAR undecoratedName[MAX_SYM_NAME] = { {'\0'} };
@@ -109,7 +123,7 @@ void profiler::__GetFuncInfo(FuncID func, FuncInfo& info) {
 			// error();
 		}
 		else
-			strcpy_s(info.funcName, undecoratedName);
+			strcpy_s(funcName, undecoratedName);
 	}
 
 	//////////////////////////////////////////////////////////////////////////////
@@ -119,17 +133,130 @@ void profiler::__GetFuncInfo(FuncID func, FuncInfo& info) {
 	IMAGEHLP_LINE64 lineInfo{};
 	lineInfo.SizeOfStruct = sizeof(IMAGEHLP_LINE64);
 	if (!SymGetLineFromAddr64(GetCurrentProcess(), (DWORD64)func, &dwDisplacement2, &lineInfo)) {
-		sprintf_s(info.fileName, "SymGetLineFromAddr64 (%d)", GetLastError());
+		sprintf_s(fileName, "SymGetLineFromAddr64 (%d)", GetLastError());
 		info.fileLine = 0;
 		//error();
 	}
 	else {
-		strcpy_s(info.fileName, lineInfo.FileName);
+		strcpy_s(fileName, lineInfo.FileName);
 		info.fileLine = lineInfo.LineNumber;
 	}
 
 	info.id = func;
-	info.funcNameLen = strnlen_s(info.funcName, 1024);
-	info.funcNameExtLen = strnlen_s(info.funcNameExt, 1024);
-	info.fileNameLen = strnlen_s(info.fileName, 1024);
-}
\ No newline at end of file
+	__SetFuncInfoNames(info, funcName, funcNameExt, fileName);
+	return resolved;
+}
+
+// PDB signature (GUID + age), the key used by symbol servers
+static std::string __GetPdbSignature(HMODULE hModule) {
+	struct CodeViewInfo {
+		DWORD signature; // 'RSDS'
+		GUID guid;
+		DWORD age;
+	};
+	ULONG size = 0;
+	auto* debugDir = (PIMAGE_DEBUG_DIRECTORY)ImageDirectoryEntryToData(hModule, TRUE, IMAGE_DIRECTORY_ENTRY_DEBUG, &size);
+	for (ULONG i = 0; debugDir != NULL && i < size / sizeof(IMAGE_DEBUG_DIRECTORY); ++i) {
+		if (debugDir[i].Type != IMAGE_DEBUG_TYPE_CODEVIEW || debugDir[i].SizeOfData < sizeof(CodeViewInfo))
+			continue;
+		const auto* cv = (const CodeViewInfo*)((const BYTE*)hModule + debugDir[i].AddressOfRawData);
+		if (cv->signature != 0x53445352) continue; // "RSDS" (PDB 7.0)
+		char buffer[64] = { {'\0'} };
+		sprintf_s(buffer, "%08lX%04X%04X%02X%02X%02X%02X%02X%02X%02X%02X%lX",
+			cv->guid.Data1, cv->guid.Data2, cv->guid.Data3,
+			cv->guid.Data4[0], cv->guid.Data4[1], cv->guid.Data4[2], cv->guid.Data4[3],
+			cv->guid.Data4[4], cv->guid.Data4[5], cv->guid.Data4[6], cv->guid.Data4[7],
+			cv->age);
+		return buffer;
+	}
+	return {};
+}
+
+void profiler::__EnumerateModules(std::vector<ModuleInfo>& out) {
+	//////////////////////////////////////////////////////////////////////////////
+	// https://learn.microsoft.com/en-us/windows/win32/psapi/enumerating-all-modules-for-a-process
+	HANDLE process = GetCurrentProcess();
+	HMODULE modules[1024];
+	DWORD needed = 0;
+	if (!EnumProcessModules(process, modules, sizeof(modules), &needed)) {
+		error();
+		return;
+	}
+	DWORD count = needed / (DWORD)sizeof(HMODULE);
+	if (count > sizeof(modules) / sizeof(HMODULE)) count = sizeof(modules) / sizeof(HMODULE);
+	for (DWORD i = 0; i < count; ++i) {
+		MODULEINFO moduleInfo{};
+		if (!GetModuleInformation(process, modules[i], &moduleInfo, sizeof(moduleInfo)))
+			continue;
+		char path[MAX_PATH] = { {'\0'} };
+		GetModuleFileNameA(modules[i], path, MAX_PATH);
+		ModuleInfo module;
+		module.path = path;
+		module.buildId = __GetPdbSignature(modules[i]);
+		module.base = (unsigned long long)moduleInfo.lpBaseOfDll;
+		module.size = moduleInfo.SizeOfImage;
+		module.bias = module.base; // FuncID - base = RVA
+		out.push_back(std::move(module));
+	}
+}
+
+void profiler::__EnumerateSymbols(std::vector<__SymbolEntry>& out) {
+	// Called with the resolver lock held
+	if (!gSymbolsInitialized)
+		gSymbolsInitialized = __Init(gModule != NULL ? gModule : GetModuleHandleA(NULL)); // NULL when linked statically
+	HANDLE process = GetCurrentProcess();
+	SymRefreshModuleList(process); // Modules loaded since 'SymInitialize'
+
+	struct Symbol { DWORD64 addr; ULONG size; std::string name; };
+	struct Line { DWORD64 addr; const char* file; DWORD line; };
+	std::vector<ModuleInfo> modules;
+	__EnumerateModules(modules);
+	for (const ModuleInfo& module : modules) {
+		//////////////////////////////////////////////////////////////////////////////
+		// https://learn.microsoft.com/en-us/windows/win32/debug/enumerating-symbols
+		// 1. Function symbols of the module, in bulk
+		std::vector<Symbol> symbols;
+		SymEnumSymbols(process, module.base, "*", [](PSYMBOL_INFO pSymInfo, ULONG, PVOID context) -> BOOL {
+			if (pSymInfo->Tag == 5) // SymTagFunction ('cvconst.h')
+				((std::vector<Symbol>*)context)->push_back({ pSymInfo->Address, pSymInfo->Size, std::string(pSymInfo->Name, pSymInfo->NameLen) });
+			return TRUE;
+		}, &symbols);
+		if (symbols.empty()) continue;
+
+		//////////////////////////////////////////////////////////////////////////////
+		// 2. Line table of the module, in bulk (instead of one 'SymGetLineFromAddr64' per symbol)
+		std::vector<Line> lines;
+		SymEnumLines(process, module.base, NULL, NULL, [](PSRCCODEINFO lineInfo, PVOID context) -> BOOL {
+			((std::vector<Line>*)context)->push_back({ lineInfo->Address, profiler::__InternString(lineInfo->FileName, strlen(lineInfo->FileName)), lineInfo->LineNumber });
+			return TRUE;
+		}, &lines);
+		std::sort(lines.begin(), lines.end(), [](const Line& a, const Line& b) { return a.addr < b.addr; });
+
+		//////////////////////////////////////////////////////////////////////////////
+		// 3. Join
+		out.reserve(out.size() + symbols.size());
+		for (const Symbol& symbol : symbols) {
+			CHAR undecoratedName[MAX_SYM_NAME] = { {'\0'} };
+			if (UnDecorateSymbolName(symbol.name.c_str(), undecoratedName, MAX_SYM_NAME, UNDNAME_COMPLETE) == NULL)
+				strcpy_s(undecoratedName, symbol.name.c_str());
+			auto line = std::lower_bound(lines.begin(), lines.end(), symbol.addr, [](const Line& line, DWORD64 addr) {
+				return line.addr < addr;
+			});
+			const bool hasLine = line != lines.end() && line->addr - symbol.addr < std::max<DWORD64>(symbol.size, 1);
+
+			__SymbolEntry entry{ {}, symbol.size };
+			entry.info.id = (FuncID)symbol.addr;
+			entry.info.fileLine = hasLine ? (int)line->line : 0;
+			__SetFuncInfoNames(entry.info, undecoratedName, symbol.name.c_str(), hasLine ? line->file : module.path.c_str());
+			out.push_back(entry);
+		}
+	}
+}
+
+unsigned long long profiler::__GetCurrentThreadOSID() {
+	return GetCurrentThreadId();
+}
+
+void profiler::__LowerThreadPriority() {
+	SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_LOWEST);
+}
@@ -0,0 +1,347 @@
+#include "profilerlib.hpp"
+
+#include <atomic>
+#include <mutex>
+#include <thread>
+
+//////////////////////////////////////////////////////////////////////////////
+// Parallel replay of large frames (see 'SetAggregationThreads').
+// The history is cut into chunks, replayed in two parallel passes around a serial stitch:
+//   1. Each chunk is scanned for its clock (times are deltas, but for the time escapes) and its
+//      stack effect: how many exits pop calls of the previous chunks, which calls are left running.
+//   2. A prefix over the chunks gives each one its start time and the calls running when it
+//      starts (its inherited stack, so recursion is collapsed exactly).
+//   3. Each chunk is replayed from its inherited stack into per-worker partial stats. Calls that
+//      span several chunks are reduced at the end: their exit gives the inclusive time, and every
+//      chunk they span gives part of their callees' time (for their self time).
+// Chunks are spread over the workers' queues: idle workers steal from the others.
+
+// Smaller frames are replayed serially (a couple of ms): half the default history capacity, so that
+// frames of default-sized histories get there too
+constexpr size_t gParallelMinEvents = profiler::FrameHistoryDefaultCapacity / 2;
+constexpr size_t gParallelMinChunk = 1 << 14; // Events (frames at the threshold are cut in 8 chunks at least)
+constexpr unsigned int gNoCall = ~0u;
+
+//////////////////////////////////////////////////////////////////////////////
+// Work-stealing pool
+
+struct WorkerQueue {
+	alignas(64) std::mutex lock{};
+	size_t begin = 0; // Tasks [begin, end): the owner takes from the front, thieves from the back
+	size_t end = 0;
+};
+
+using PoolTask = void (*)(void* context, size_t task, unsigned int worker);
+
+static std::mutex gPoolControlLock{}; // Start / stop
+static std::mutex gPoolJobLock{}; // One job at a time (callers finding it busy replay serially)
+static std::vector<std::thread> gPoolThreads{};
+static std::unique_ptr<WorkerQueue[]> gPoolQueues{};
+static unsigned int gPoolSize = 1; // Workers, the caller included (worker 0)
+alignas(64) static std::atomic<unsigned int> gPoolGeneration = 0; // Bumped on every job (and on stop)
+alignas(64) static std::atomic<unsigned int> gPoolDone = 0; // Threads done with the current job
+static std::atomic<bool> gPoolStop = false;
+static PoolTask gPoolTask = nullptr;
+static void* gPoolContext = nullptr;
+
+static bool __TakeTask(unsigned int worker, size_t& task) {
+	for (unsigned int i = 0; i < gPoolSize; ++i) {
+		WorkerQueue& queue = gPoolQueues[(worker + i) % gPoolSize];
+		std::lock_guard<std::mutex> lock(queue.lock);
+		if (queue.begin == queue.end) continue;
+		task = (i == 0) ? queue.begin++ : --queue.end;
+		return true;
+	}
+	return false;
+}
+
+static void __RunTasks(unsigned int worker) {
+	size_t task = 0;
+	while (__TakeTask(worker, task))
+		gPoolTask(gPoolContext, task, worker);
+}
+
+static void __PoolMain(unsigned int worker, unsigned int generation) {
+	profiler::__IgnoreThreadHooks();
+	for (;;) {
+		gPoolGeneration.wait(generation, std::memory_order_acquire);
+		generation = gPoolGeneration.load(std::memory_order_acquire);
+		if (gPoolStop.load(std::memory_order_acquire)) return;
+		__RunTasks(worker);
+		gPoolDone.fetch_add(1, std::memory_order_release);
+		gPoolDone.notify_one();
+	}
+}
+
+// Runs 'fn(task, worker)' for every task in [0, count), the caller included (gPoolJobLock held)
+template <typename F>
+static void __ParallelFor(size_t count, F& fn) {
+	for (unsigned int worker = 0; worker < gPoolSize; ++worker) {
+		WorkerQueue& queue = gPoolQueues[worker];
+		std::lock_guard<std::mutex> lock(queue.lock);
+		queue.begin = count * worker / gPoolSize;
+		queue.end = count * (worker + 1) / gPoolSize;
+	}
+	gPoolTask = [](void* context, size_t task, unsigned int worker) { (*(F*)context)(task, worker); };
+	gPoolContext = &fn;
+	gPoolDone.store(0, std::memory_order_relaxed);
+	gPoolGeneration.fetch_add(1, std::memory_order_release);
+	gPoolGeneration.notify_all();
+	__RunTasks(0);
+	for (unsigned int done = 0; (done = gPoolDone.load(std::memory_order_acquire)) != gPoolSize - 1; )
+		gPoolDone.wait(done, std::memory_order_acquire);
+}
+
+static void __StopPool() {
+	gPoolStop.store(true, std::memory_order_release);
+	gPoolGeneration.fetch_add(1, std::memory_order_release);
+	gPoolGeneration.notify_all();
+	for (std::thread& thread : gPoolThreads)
+		thread.join();
+	gPoolThreads.clear();
+	gPoolStop.store(false, std::memory_order_relaxed);
+}
+
+// Joins the threads before static destruction ('std::thread' must not be destroyed joinable)
+static struct PoolGuard {
+	~PoolGuard() {
+		std::lock_guard<std::mutex> lock(gPoolControlLock);
+		std::lock_guard<std::mutex> jobLock(gPoolJobLock);
+		__StopPool();
+	}
+} gPoolGuard{};
+
+//////////////////////////////////////////////////////////////////////////////
+// Replay
+
+struct OpenCall {
+	profiler::FuncIndex func;
+	profiler::TimeStamp time; // From the chunk's start, unless 'absolute'
+	bool absolute;
+};
+
+struct RunningCall {
+	profiler::FuncIndex func;
+	profiler::TimeStamp start;
+	unsigned int id; // Calls spanning several chunks, numbered in entering order
+};
+
+struct ChunkScan {
+	size_t begin, end; // Events
+	// 1. Scan
+	profiler::TimeStamp endTime; // From the chunk's start, unless 'endAbsolute'
+	bool endAbsolute;
+	size_t unmatched; // Exits of calls entered in previous chunks
+	std::vector<OpenCall> open; // Calls left running (outermost first)
+	// 2. Stitch
+	profiler::TimeStamp startTime;
+	std::vector<RunningCall> inherited; // Outermost first
+	unsigned int firstOpenId;
+};
+
+struct ReplayEntry {
+	profiler::FuncIndex func;
+	profiler::TimeStamp start;
+	profiler::DeltaTicks children; // Callees' time within the chunk
+	unsigned int id; // 'gNoCall' for calls entered in the chunk (until it ends)
+};
+
+struct SplitExit {
+	unsigned int id;
+	profiler::FuncIndex func;
+	profiler::DeltaTicks delta;
+	profiler::DeltaTicks children; // Within the exit's chunk
+	bool outermost;
+};
+
+struct SplitChildren {
+	unsigned int id;
+	profiler::DeltaTicks children; // Within a chunk the call spans
+};
+
+struct WorkerState {
+	profiler::StatsTable stats{}; // Partial (reset after every frame)
+	std::vector<profiler::FuncIndex> touched{};
+	std::vector<unsigned int> depth{}; // Per FuncIndex (recursion)
+	std::vector<ReplayEntry> stack{};
+	std::vector<SplitExit> exits{};
+	std::vector<SplitChildren> children{};
+};
+
+static auto& gChunks = *new std::vector<ChunkScan>();
+static auto& gWorkers = *new std::vector<WorkerState>();
+static auto& gCallChildren = *new std::vector<profiler::DeltaTicks>();
+
+// Same accounting as the serial replay (see 'StatsTable::record'), 'stats' only holds this frame
+static inline void __Record(profiler::StatsTable& stats, std::vector<profiler::FuncIndex>& touched,
+	profiler::FuncIndex func, profiler::DeltaTicks delta, profiler::DeltaTicks self, bool outermost)
+{
+	if (stats.record(func, delta, self, outermost).invocationCount == 1)
+		touched.push_back(func);
+}
+
+static void __ScanChunk(const profiler::FrameHistory& history, ChunkScan& chunk) {
+	using profiler::FrameHistory;
+	profiler::TimeStamp time = 0;
+	bool absolute = false;
+	chunk.unmatched = 0;
+	chunk.open.clear();
+	for (size_t i = chunk.begin; i < chunk.end; ++i) {
+		const profiler::FrameHistoryEvent ev = history.at(i);
+		const profiler::FrameHistoryEvent payload = ev & FrameHistory::EventPayloadMask;
+		switch (ev & FrameHistory::EventKindMask) {
+		case FrameHistory::EventTime:
+			time = payload;
+			absolute = true;
+			break;
+		case FrameHistory::EventEnter:
+			time += payload >> 32;
+			chunk.open.push_back({ (profiler::FuncIndex)(payload & 0xFFFFFFFF), time, absolute });
+			break;
+		default:
+			time += payload;
+			if (chunk.open.empty())
+				chunk.unmatched++;
+			else
+				chunk.open.pop_back();
+		}
+	}
+	chunk.endTime = time;
+	chunk.endAbsolute = absolute;
+}
+
+// Same accounting as the serial replay (see '__PopStack'), from the chunk's inherited stack
+static void __ReplayChunk(const profiler::FrameHistory& history, const ChunkScan& chunk, WorkerState& worker) {
+	using profiler::FrameHistory;
+	auto depth = [&](profiler::FuncIndex func) -> unsigned int& {
+		if (func >= worker.depth.size()) [[unlikely]]
+			worker.depth.resize(std::max<size_t>(func + 1, worker.depth.size() * 2));
+		return worker.depth[func];
+	};
+	worker.stack.clear();
+	for (const RunningCall& call : chunk.inherited) {
+		worker.stack.push_back({ .func = call.func, .start = call.start, .children = 0, .id = call.id });
+		depth(call.func)++;
+	}
+
+	profiler::TimeStamp time = chunk.startTime;
+	for (size_t i = chunk.begin; i < chunk.end; ++i) {
+		const profiler::FrameHistoryEvent ev = history.at(i);
+		const profiler::FrameHistoryEvent payload = ev & FrameHistory::EventPayloadMask;
+		const profiler::FrameHistoryEvent kind = ev & FrameHistory::EventKindMask;
+		if (kind == FrameHistory::EventTime) {
+			time = payload;
+			continue;
+		}
+		if (kind == FrameHistory::EventEnter) {
+			time += payload >> 32;
+			const profiler::FuncIndex func = (profiler::FuncIndex)(payload & 0xFFFFFFFF);
+			worker.stack.push_back({ .func = func, .start = time, .children = 0, .id = gNoCall });
+			depth(func)++;
+			continue;
+		}
+		time += payload;
+		if (worker.stack.empty()) continue;
+		const ReplayEntry top = worker.stack.back();
+		worker.stack.pop_back();
+		const profiler::DeltaTicks delta = (profiler::DeltaTicks)(time - top.start);
+		const bool outermost = (--worker.depth[top.func] == 0);
+		if (top.id != gNoCall)
+			worker.exits.push_back({ top.id, top.func, delta, top.children, outermost });
+		else
+			__Record(worker.stats, worker.touched, top.func, delta, delta - top.children, outermost);
+		if (!worker.stack.empty())
+			worker.stack.back().children += delta;
+	}
+
+	// Calls still running: the ones entered here get the ids of the stitch (same order)
+	unsigned int id = chunk.firstOpenId;
+	for (ReplayEntry& e : worker.stack) {
+		worker.depth[e.func]--;
+		if (e.id == gNoCall) e.id = id++;
+		if (e.children != 0)
+			worker.children.push_back({ e.id, e.children });
+	}
+}
+
+bool profiler::__AggregateParallel(const FrameHistory& history, StatsTable& frame, std::vector<FuncIndex>& touched) {
+	if (history.size() < gParallelMinEvents) return false;
+	std::unique_lock<std::mutex> lock(gPoolJobLock, std::try_to_lock);
+	if (!lock.owns_lock() || gPoolSize <= 1) return false;
+
+	//////////////////////////////////////////////////////////////////////////////
+	// 1. Scan the chunks
+	const size_t chunkSize = std::max<size_t>(gParallelMinChunk, history.size() / (gPoolSize * 8));
+	const size_t chunkCount = (history.size() + chunkSize - 1) / chunkSize;
+	gChunks.resize(chunkCount);
+	for (size_t k = 0; k < chunkCount; ++k) {
+		gChunks[k].begin = k * chunkSize;
+		gChunks[k].end = std::min(history.size(), (k + 1) * chunkSize);
+	}
+	auto scan = [&](size_t task, unsigned int) { __ScanChunk(history, gChunks[task]); };
+	__ParallelFor(chunkCount, scan);
+
+	//////////////////////////////////////////////////////////////////////////////
+	// 2. Stitch: start time and inherited stack of every chunk
+	std::vector<RunningCall> running;
+	TimeStamp time = history.baseTime();
+	unsigned int nextId = 0;
+	for (ChunkScan& chunk : gChunks) {
+		chunk.startTime = time;
+		chunk.inherited = running;
+		running.resize(running.size() - std::min(chunk.unmatched, running.size()));
+		chunk.firstOpenId = nextId;
+		for (const OpenCall& call : chunk.open)
+			running.push_back({ call.func, call.absolute ? call.time : time + call.time, nextId++ });
+		time = chunk.endAbsolute ? chunk.endTime : time + chunk.endTime;
+	}
+
+	//////////////////////////////////////////////////////////////////////////////
+	// 3. Replay the chunks
+	gWorkers.resize(gPoolSize);
+	auto replay = [&](size_t task, unsigned int worker) { __ReplayChunk(history, gChunks[task], gWorkers[worker]); };
+	__ParallelFor(chunkCount, replay);
+
+	//////////////////////////////////////////////////////////////////////////////
+	// 4. Reduce: calls spanning chunks, then the partial stats
+	gCallChildren.assign(nextId, 0);
+	for (WorkerState& worker : gWorkers) {
+		for (const SplitChildren& c : worker.children)
+			gCallChildren[c.id] += c.children;
+		worker.children.clear();
+	}
+	for (WorkerState& worker : gWorkers) {
+		for (const SplitExit& e : worker.exits)
+			__Record(frame, touched, e.func, e.delta, e.delta - e.children - gCallChildren[e.id], e.outermost);
+		worker.exits.clear();
+		for (FuncIndex func : worker.touched) {
+			FuncStats& entry = frame[func];
+			if (entry.invocationCount == 0)
+				touched.push_back(func);
+			entry.merge(worker.stats[func]);
+			frame.histogram(func).merge(worker.stats.histogram(func));
+			worker.stats[func] = FuncStats{};
+			worker.stats.histogram(func).clear();
+		}
+		worker.touched.clear();
+	}
+	return true;
+}
+
+void profiler::SetAggregationThreads(unsigned int count) {
+	std::lock_guard<std::mutex> lock(gPoolControlLock);
+	std::lock_guard<std::mutex> jobLock(gPoolJobLock);
+	count = std::max(count, 1u);
+	if (count == gPoolSize) return;
+	__StopPool();
+	gPoolSize = count;
+	gPoolQueues = std::make_unique<WorkerQueue[]>(count);
+	const unsigned int generation = gPoolGeneration.load(std::memory_order_relaxed);
+	for (unsigned int worker = 1; worker < count; ++worker)
+		gPoolThreads.push_back(std::thread(__PoolMain, worker, generation));
+}
+
+unsigned int profiler::GetAggregationThreads() {
+	std::lock_guard<std::mutex> lock(gPoolControlLock);
+	return gPoolSize;
+}
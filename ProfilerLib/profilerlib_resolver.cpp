@@ -0,0 +1,130 @@
+#include "profilerlib.hpp"
+
+#include <atomic>
+#include <mutex>
+#include <thread>
+
+//////////////////////////////////////////////////////////////////////////////
+// Background symbol resolver (see 'SetSymbolResolverThread').
+// Newly interned FuncIndices go through a bounded lock-free MPMC ring (D. Vyukov) to a
+// low-priority thread that resolves them. Pushes never block: when the ring is full the index
+// is dropped, and pushed again by the first 'GetFuncInfo' that gets its placeholder.
+// https://www.1024cores.net/home/lock-free-algorithms/queues/bounded-mpmc-queue
+
+constexpr size_t gResolverQueueSize = 1 << 14; // power of 2
+
+struct ResolverCell {
+	std::atomic<size_t> sequence;
+	profiler::FuncIndex index;
+};
+
+static ResolverCell gResolverQueue[gResolverQueueSize] = {};
+alignas(64) static std::atomic<size_t> gResolverQueueTail = 0; // Producers
+alignas(64) static std::atomic<size_t> gResolverQueueHead = 0; // Consumer
+alignas(64) static std::atomic<unsigned int> gResolverSignal = 0; // Bumped on push, waited on when idle
+static std::atomic<bool> gResolverRunning = false;
+static std::atomic<bool> gResolverStop = false;
+static std::mutex gResolverControlLock{};
+static std::thread gResolverThread{};
+
+static bool __Push(profiler::FuncIndex index) {
+	size_t pos = gResolverQueueTail.load(std::memory_order_relaxed);
+	ResolverCell* cell = nullptr;
+	for (;;) {
+		cell = &gResolverQueue[pos & (gResolverQueueSize - 1)];
+		size_t sequence = cell->sequence.load(std::memory_order_acquire);
+		intptr_t diff = (intptr_t)sequence - (intptr_t)pos;
+		if (diff == 0) {
+			if (gResolverQueueTail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+		}
+		else if (diff < 0) return false; // Full
+		else pos = gResolverQueueTail.load(std::memory_order_relaxed);
+	}
+	cell->index = index;
+	cell->sequence.store(pos + 1, std::memory_order_release);
+	return true;
+}
+
+static bool __Pop(profiler::FuncIndex& index) {
+	size_t pos = gResolverQueueHead.load(std::memory_order_relaxed);
+	ResolverCell* cell = nullptr;
+	for (;;) {
+		cell = &gResolverQueue[pos & (gResolverQueueSize - 1)];
+		size_t sequence = cell->sequence.load(std::memory_order_acquire);
+		intptr_t diff = (intptr_t)sequence - (intptr_t)(pos + 1);
+		if (diff == 0) {
+			if (gResolverQueueHead.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+		}
+		else if (diff < 0) return false; // Empty
+		else pos = gResolverQueueHead.load(std::memory_order_relaxed);
+	}
+	index = cell->index;
+	cell->sequence.store(pos + gResolverQueueSize, std::memory_order_release);
+	return true;
+}
+
+static void __ResolverMain() {
+	profiler::__LowerThreadPriority();
+	profiler::__IgnoreThreadHooks();
+	while (!gResolverStop.load(std::memory_order_acquire)) {
+		unsigned int signal = gResolverSignal.load(std::memory_order_acquire);
+		profiler::FuncIndex index = 0;
+		while (!gResolverStop.load(std::memory_order_relaxed) && __Pop(index))
+			profiler::__ResolveFuncIndex(index);
+		gResolverSignal.wait(signal, std::memory_order_acquire);
+	}
+}
+
+static void __StopResolver() {
+	if (!gResolverThread.joinable()) return;
+	gResolverRunning.store(false, std::memory_order_release);
+	gResolverStop.store(true, std::memory_order_release);
+	gResolverSignal.fetch_add(1, std::memory_order_release);
+	gResolverSignal.notify_all();
+	gResolverThread.join();
+}
+
+// Joins the thread before static destruction ('std::thread' must not be destroyed joinable)
+static struct ResolverGuard {
+	~ResolverGuard() {
+		std::lock_guard<std::mutex> lock(gResolverControlLock);
+		__StopResolver();
+	}
+} gResolverGuard{};
+
+//////////////////////////////////////////////////////////////////////////////
+
+void profiler::__EnqueueFuncIndex(FuncIndex index) {
+	if (!gResolverRunning.load(std::memory_order_relaxed)) return;
+	if (!__Push(index)) return;
+	gResolverSignal.fetch_add(1, std::memory_order_release);
+	gResolverSignal.notify_one();
+}
+
+void profiler::SetSymbolResolverThread(bool enabled) {
+	std::lock_guard<std::mutex> lock(gResolverControlLock);
+	if (enabled == gResolverThread.joinable()) return;
+	if (!enabled) {
+		__StopResolver();
+		return;
+	}
+
+	//////////////////////////////////////////////////////////////////////////////
+	// 1. Reset the ring (nobody pushes while stopped)
+	for (size_t i = 0; i < gResolverQueueSize; ++i)
+		gResolverQueue[i].sequence.store(i, std::memory_order_relaxed);
+	gResolverQueueTail.store(0, std::memory_order_relaxed);
+	gResolverQueueHead.store(0, std::memory_order_relaxed);
+	gResolverStop.store(false, std::memory_order_relaxed);
+	gResolverRunning.store(true, std::memory_order_release);
+	gResolverThread = std::thread(__ResolverMain);
+
+	//////////////////////////////////////////////////////////////////////////////
+	// 2. Catch up with the functions interned so far
+	for (FuncIndex index = 0; index < __GetFuncCount(); ++index)
+		if (__FindFuncInfo(index) == nullptr) __EnqueueFuncIndex(index);
+}
+
+bool profiler::GetSymbolResolverThread() {
+	return gResolverRunning.load(std::memory_order_relaxed);
+}
@@ -0,0 +1,87 @@
+#include "profilerlib.hpp"
+
+#include <cmath>
+#include <stdexcept>
+
+profiler::StatsTable::const_iterator::reference profiler::StatsTable::const_iterator::operator*() const {
+	return { __GetFuncIDFromIndex(_index), _table->_stats[_index] };
+}
+
+const profiler::FuncStats* profiler::StatsTable::find(FuncID func) const {
+	FuncIndex index = 0;
+	if (!__FindFuncIndex(func, index)) return nullptr;
+	return find(index);
+}
+
+const profiler::FuncStats& profiler::StatsTable::at(FuncID func) const {
+	const FuncStats* stats = find(func);
+	if (stats == nullptr) throw std::out_of_range("profiler::StatsTable::at");
+	return *stats;
+}
+
+const profiler::LatencyHistogram* profiler::StatsTable::findHistogram(FuncID func) const {
+	FuncIndex index = 0;
+	if (!__FindFuncIndex(func, index)) return nullptr;
+	return findHistogram(index);
+}
+
+profiler::StatsTable::StatsTable(const StatsTable& other) {
+	*this = other;
+}
+
+profiler::StatsTable& profiler::StatsTable::operator=(const StatsTable& other) {
+	if (this == &other) return *this;
+	_stats = other._stats;
+	_histograms.clear();
+	_histograms.resize(other._histograms.size());
+	for (size_t i = 0; i < other._histograms.size(); ++i)
+		if (other._histograms[i] != nullptr)
+			_histograms[i] = std::make_unique<LatencyHistogram>(*other._histograms[i]);
+	return *this;
+}
+
+void profiler::StatsTable::merge(const StatsTable& other) {
+	for (FuncIndex index = 0; index < (FuncIndex)other._stats.size(); ++index) {
+		if (other._stats[index].invocationCount == 0) continue;
+		(*this)[index].merge(other._stats[index]);
+		if (const LatencyHistogram* histogram = other.findHistogram(index))
+			this->histogram(index).merge(*histogram);
+	}
+}
+
+size_t profiler::StatsTable::size() const {
+	size_t count = 0;
+	for (const auto& stats : _stats)
+		count += (stats.invocationCount != 0);
+	return count;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+void profiler::LatencyHistogram::merge(const LatencyHistogram& other) {
+	for (int i = 0; i < BucketCount; ++i)
+		_counts[i] += other._counts[i];
+	_count += other._count;
+}
+
+void profiler::LatencyHistogram::clear() {
+	std::fill(std::begin(_counts), std::end(_counts), 0u);
+	_count = 0;
+}
+
+profiler::DeltaTicks profiler::LatencyHistogram::percentile(double p) const {
+	if (_count == 0) return 0;
+	// Nearest rank
+	unsigned long long rank = (unsigned long long)std::ceil(std::clamp(p, 0.0, 100.0) / 100.0 * (double)_count);
+	rank = std::max(rank, 1ull);
+	unsigned long long seen = 0;
+	int bucket = 0;
+	for (; bucket < BucketCount - 1; ++bucket) {
+		seen += _counts[bucket];
+		if (seen >= rank) break;
+	}
+	if (bucket < (1 << SubBucketBits)) return bucket; // Exact
+	int shift = (bucket >> SubBucketBits) - 1;
+	DeltaTicks lower = (DeltaTicks)(((1ull << SubBucketBits) + (bucket & ((1 << SubBucketBits) - 1))) << shift);
+	return lower + ((1ll << shift) >> 1);
+}
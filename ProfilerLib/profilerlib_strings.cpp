@@ -0,0 +1,54 @@
+#include "profilerlib.hpp"
+
+#include <cstring>
+#include <mutex>
+#include <string_view>
+#include <unordered_set>
+
+//////////////////////////////////////////////////////////////////////////////
+// Process-wide interned string pool.
+// Strings are copied (NUL-terminated) into 64KB arena blocks and deduplicated,
+// so that repeated names (file paths above all) are stored once. Never freed.
+
+static constexpr size_t gStringBlockSize = 64 * 1024;
+
+static std::mutex gStringPoolLock{};
+static auto& gStringPool = *new std::unordered_set<std::string_view>(); // Outlives static destructors
+static char* gStringBlock = nullptr; // Current block
+static size_t gStringBlockUsed = gStringBlockSize;
+
+const char* profiler::__InternString(const char* str, size_t len) {
+	std::lock_guard<std::mutex> lock(gStringPoolLock);
+	//////////////////////////////////////////////////////////////////////////////
+	// 1. Already there
+	if (auto it = gStringPool.find(std::string_view(str, len)); it != gStringPool.end())
+		return it->data();
+
+	//////////////////////////////////////////////////////////////////////////////
+	// 2. Copy into the arena (big strings get an allocation of their own)
+	char* dst = nullptr;
+	if (len + 1 > gStringBlockSize / 4) {
+		dst = new char[len + 1];
+	}
+	else {
+		if (gStringBlockUsed + len + 1 > gStringBlockSize) {
+			gStringBlock = new char[gStringBlockSize];
+			gStringBlockUsed = 0;
+		}
+		dst = gStringBlock + gStringBlockUsed;
+		gStringBlockUsed += len + 1;
+	}
+	memcpy(dst, str, len);
+	dst[len] = '\0';
+	gStringPool.insert(std::string_view(dst, len));
+	return dst;
+}
+
+void profiler::__SetFuncInfoNames(FuncInfo& info, const char* funcName, const char* funcNameExt, const char* fileName) {
+	info.funcNameLen = (unsigned int)strlen(funcName);
+	info.funcNameExtLen = (unsigned int)strlen(funcNameExt);
+	info.fileNameLen = (unsigned int)strlen(fileName);
+	info.funcName = __InternString(funcName, info.funcNameLen);
+	info.funcNameExt = __InternString(funcNameExt, info.funcNameExtLen);
+	info.fileName = __InternString(fileName, info.fileNameLen);
+}
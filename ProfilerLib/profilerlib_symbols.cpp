@@ -0,0 +1,227 @@
+#include "profilerlib.hpp"
+
+#include <atomic>
+#include <cstdio>
+#include <mutex>
+#include <stdexcept>
+
+//////////////////////////////////////////////////////////////////////////////
+// Process-wide symbol cache, indexed by FuncIndex.
+// Hits are a lock-free pointer load. Misses are resolved by one thread at a time
+// (symbol APIs like DbgHelp aren't thread-safe anyway) and published with release semantics.
+// Resolved entries are never freed nor moved: references stay valid from any thread.
+
+static_assert(sizeof(profiler::FuncInfo) <= 64, "FuncInfo should fit a cache line");
+
+using FuncInfoSlot = std::atomic<const profiler::FuncInfo*>;
+
+static std::mutex gSymbolResolverLock{};
+static std::mutex gPlaceholderLock{};
+static std::atomic<profiler::SymbolMode> gSymbolMode = profiler::SymbolMode::InProcess;
+static std::atomic<FuncInfoSlot*> gFuncInfos[profiler::__FuncChunkCount] = {};
+static std::atomic<FuncInfoSlot*> gPlaceholders[profiler::__FuncChunkCount] = {}; // While the resolver thread is on it
+
+static FuncInfoSlot* __GetSlot(std::atomic<FuncInfoSlot*>* chunks, profiler::FuncIndex index, bool create) {
+	FuncInfoSlot* chunk = chunks[index / profiler::__FuncChunkSize].load(std::memory_order_acquire);
+	if (chunk == nullptr) {
+		if (!create) return nullptr;
+		// Called with the lock guarding 'chunks' held
+		chunk = new FuncInfoSlot[profiler::__FuncChunkSize]();
+		chunks[index / profiler::__FuncChunkSize].store(chunk, std::memory_order_release);
+	}
+	return &chunk[index % profiler::__FuncChunkSize];
+}
+
+const profiler::FuncInfo* profiler::__FindFuncInfo(FuncIndex index) {
+	FuncInfoSlot* slot = __GetSlot(gFuncInfos, index, false);
+	return (slot == nullptr) ? nullptr : slot->load(std::memory_order_acquire);
+}
+
+static auto& gModules = *new std::vector<profiler::ModuleInfo>(); // Snapshot, refreshed on unknown addresses
+static bool gSymbolCacheEnabled = false;
+
+// Called with 'gSymbolResolverLock' held
+static const profiler::ModuleInfo* __FindModule(profiler::FuncID func) {
+	const unsigned long long addr = (unsigned long long)func;
+	auto find = [&]() -> const profiler::ModuleInfo* {
+		for (const profiler::ModuleInfo& module : gModules)
+			if (addr - module.base < module.size) return &module;
+		return nullptr;
+	};
+	if (const profiler::ModuleInfo* module = find()) return module;
+	// Loaded after the last snapshot
+	gModules.clear();
+	profiler::__EnumerateModules(gModules);
+	return find();
+}
+
+// "module+0xoffset", without touching any symbol file (see SymbolMode::Deferred)
+static void __GetFuncPlaceholder(profiler::FuncID func, profiler::FuncInfo& info) {
+	const profiler::ModuleInfo* module = __FindModule(func);
+	char funcName[1024] = { '\0' };
+	char funcNameExt[64] = { '\0' };
+	snprintf(funcNameExt, sizeof(funcNameExt), "0x%llx", (unsigned long long)func);
+	if (module != nullptr) {
+		const char* moduleName = module->path.c_str();
+		for (const char* c = moduleName; *c != '\0'; ++c)
+			if (*c == '/' || *c == '\\') moduleName = c + 1;
+		snprintf(funcName, sizeof(funcName), "%s+0x%llx", moduleName, (unsigned long long)func - module->bias);
+	}
+	else
+		snprintf(funcName, sizeof(funcName), "%s", funcNameExt);
+
+	info.id = func;
+	info.fileLine = 0;
+	profiler::__SetFuncInfoNames(info, funcName, funcNameExt, module != nullptr ? module->path.c_str() : "");
+}
+
+static std::atomic<profiler::SymbolLoad> gSymbolLoad = profiler::SymbolLoad::Lazy;
+static auto& gSymbolTable = *new std::vector<profiler::__SymbolEntry>(); // Sorted by start address
+
+bool profiler::__FindSymbolEntry(FuncID func, FuncInfo& info) {
+	auto it = std::upper_bound(gSymbolTable.begin(), gSymbolTable.end(), func, [](FuncID func, const __SymbolEntry& entry) {
+		return func < entry.info.id;
+	});
+	if (it == gSymbolTable.begin()) return false;
+	--it;
+	// Symbols without a size only match their start address
+	if ((unsigned long long)func - (unsigned long long)it->info.id >= std::max(it->size, 1ull)) return false;
+	info = it->info;
+	info.id = func;
+	return true;
+}
+
+// Eager symbol table first (see 'SetSymbolLoad'), then the persistent cache (see 'SetSymbolCache'), then the platform resolver
+static void __ResolveFuncInfo(profiler::FuncID func, profiler::FuncInfo& info) {
+	if (!gSymbolTable.empty() && profiler::__FindSymbolEntry(func, info)) return;
+	const profiler::ModuleInfo* module = gSymbolCacheEnabled ? __FindModule(func) : nullptr;
+	if (module != nullptr && profiler::__FindCachedFuncInfo(*module, func, info)) return;
+	if (profiler::__GetFuncInfo(func, info) && module != nullptr)
+		profiler::__StoreCachedFuncInfo(*module, func, info);
+}
+
+const profiler::FuncInfo& profiler::__ResolveFuncIndex(FuncIndex index) {
+	std::lock_guard<std::mutex> lock(gSymbolResolverLock);
+	FuncInfoSlot* slot = __GetSlot(gFuncInfos, index, true);
+	if (const FuncInfo* info = slot->load(std::memory_order_acquire)) return *info;
+	FuncID func = __GetFuncIDFromIndex(index);
+	FuncInfo* info = new FuncInfo{};
+	if (gSymbolMode.load(std::memory_order_relaxed) == SymbolMode::Deferred)
+		__GetFuncPlaceholder(func, *info);
+	else
+		__ResolveFuncInfo(func, *info);
+	slot->store(info, std::memory_order_release);
+	return *info;
+}
+
+// Raw address, handed out while the resolver thread gets to it (never blocks on resolution)
+static const profiler::FuncInfo& __GetPendingFuncInfo(profiler::FuncIndex index) {
+	FuncInfoSlot* slot = __GetSlot(gPlaceholders, index, false);
+	if (slot != nullptr)
+		if (const profiler::FuncInfo* info = slot->load(std::memory_order_acquire)) return *info;
+
+	std::lock_guard<std::mutex> lock(gPlaceholderLock);
+	slot = __GetSlot(gPlaceholders, index, true);
+	if (const profiler::FuncInfo* info = slot->load(std::memory_order_acquire)) return *info;
+	profiler::FuncID func = profiler::__GetFuncIDFromIndex(index);
+	char funcName[64] = { '\0' };
+	snprintf(funcName, sizeof(funcName), "0x%llx", (unsigned long long)func);
+	profiler::FuncInfo* info = new profiler::FuncInfo{};
+	info->id = func;
+	profiler::__SetFuncInfoNames(*info, funcName, funcName, "");
+	slot->store(info, std::memory_order_release);
+	// Ask again: it may have been dropped by a full queue
+	profiler::__EnqueueFuncIndex(index);
+	return *info;
+}
+
+const profiler::FuncInfo& profiler::GetFuncInfo(FuncID func) {
+	//////////////////////////////////////////////////////////////////////////////
+	// 1. Hit: lock-free
+	FuncIndex index = __InternFuncID(func);
+	if (const FuncInfo* info = __FindFuncInfo(index)) return *info;
+
+	//////////////////////////////////////////////////////////////////////////////
+	// 2. Miss: placeholder if the resolver thread runs, otherwise single resolver
+	if (GetSymbolResolverThread())
+		return __GetPendingFuncInfo(index);
+	return __ResolveFuncIndex(index);
+}
+
+void profiler::SetSymbolMode(SymbolMode mode) {
+	gSymbolMode.store(mode, std::memory_order_relaxed);
+}
+
+profiler::SymbolMode profiler::GetSymbolMode() {
+	return gSymbolMode.load(std::memory_order_relaxed);
+}
+
+bool profiler::SetSymbolCache(const char* path) {
+	std::lock_guard<std::mutex> lock(gSymbolResolverLock);
+	gModules.clear();
+	__EnumerateModules(gModules);
+	gSymbolCacheEnabled = __OpenSymbolCache(path, gModules) && path != nullptr;
+	return gSymbolCacheEnabled || path == nullptr;
+}
+
+void profiler::SetSymbolLoad(SymbolLoad load) {
+	std::lock_guard<std::mutex> lock(gSymbolResolverLock);
+	gSymbolTable.clear();
+	gSymbolTable.shrink_to_fit();
+	if (load == SymbolLoad::Eager) {
+		__EnumerateSymbols(gSymbolTable);
+		std::sort(gSymbolTable.begin(), gSymbolTable.end(), [](const __SymbolEntry& a, const __SymbolEntry& b) {
+			return a.info.id < b.info.id;
+		});
+	}
+	gSymbolLoad.store(load, std::memory_order_relaxed);
+}
+
+profiler::SymbolLoad profiler::GetSymbolLoad() {
+	return gSymbolLoad.load(std::memory_order_relaxed);
+}
+
+const profiler::InfoTable& profiler::GetInfoTable() {
+	static const InfoTable table{};
+	return table;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+profiler::InfoTable::const_iterator::reference profiler::InfoTable::const_iterator::operator*() const {
+	return { __GetFuncIDFromIndex(_index), *__FindFuncInfo(_index) };
+}
+
+void profiler::InfoTable::const_iterator::__Skip() {
+	while (_index < _count && __FindFuncInfo(_index) == nullptr)
+		++_index;
+	// Functions interned after 'begin' aren't visited: collapse onto the 'end' sentinel
+	if (_index >= _count) _index = InfoTable::EndIndex;
+}
+
+const profiler::FuncInfo* profiler::InfoTable::find(FuncID func) const {
+	FuncIndex index = 0;
+	if (!__FindFuncIndex(func, index)) return nullptr;
+	return __FindFuncInfo(index);
+}
+
+const profiler::FuncInfo& profiler::InfoTable::at(FuncID func) const {
+	const FuncInfo* info = find(func);
+	if (info == nullptr) throw std::out_of_range("profiler::InfoTable::at");
+	return *info;
+}
+
+size_t profiler::InfoTable::size() const {
+	size_t count = 0;
+	for (auto it = begin(); it != end(); ++it)
+		count++;
+	return count;
+}
+
+profiler::InfoTable::const_iterator profiler::InfoTable::begin() const {
+	return const_iterator(0, __GetFuncCount());
+}
+
+profiler::InfoTable::const_iterator profiler::InfoTable::end() const {
+	return const_iterator(EndIndex, EndIndex);
+}
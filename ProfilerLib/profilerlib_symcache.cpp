@@ -0,0 +1,251 @@
+#include "profilerlib.hpp"
+
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+//////////////////////////////////////////////////////////////////////////////
+// Persistent symbol cache (see 'SetSymbolCache').
+// The file is mapped read-only and FuncInfo names point straight into it: loading only walks
+// the record headers to build the index (each record's CRC is checked on its first hit).
+// Records are keyed by (module build-id, FuncID - bias), so they survive ASLR and a rebuilt
+// module simply stops matching. Newly resolved functions are appended. Records of modules not
+// loaded at startup are stale: they are compacted away on open once they outnumber the live
+// ones (or if the file is damaged).
+// Everything here runs with the symbol resolver lock held.
+//
+//   header: "PROFSYM1"
+//   record: size (u32, padded to 8) | crc (u32, of what follows) | offset (u64) | line (i32) |
+//           buildIdLen | funcNameLen | funcNameExtLen | fileNameLen (u32) | strings (NUL-terminated)
+
+static constexpr char gCacheMagic[8] = { 'P', 'R', 'O', 'F', 'S', 'Y', 'M', '1' };
+
+struct __CacheRecord {
+	unsigned int size;
+	profiler::CRC32 crc;
+	unsigned long long offset;
+	int fileLine;
+	unsigned int buildIdLen;
+	unsigned int funcNameLen;
+	unsigned int funcNameExtLen;
+	unsigned int fileNameLen;
+};
+static_assert(sizeof(__CacheRecord) % 8 == 0, "Records are 8-byte aligned");
+
+struct __CacheKey {
+	std::string_view buildId;
+	unsigned long long offset;
+	bool operator==(const __CacheKey& other) const { return offset == other.offset && buildId == other.buildId; }
+};
+
+struct __CacheKeyHash {
+	size_t operator()(const __CacheKey& key) const {
+		return std::hash<std::string_view>{}(key.buildId) ^ (size_t)(key.offset * 0x9E3779B97F4A7C15ull);
+	}
+};
+
+static FILE* gCacheFile = nullptr; // Append handle
+static auto& gCacheIndex = *new std::unordered_map<__CacheKey, const __CacheRecord*, __CacheKeyHash>();
+
+//////////////////////////////////////////////////////////////////////////////
+
+static bool __MapFile(const char* path, const unsigned char*& data, size_t& size) {
+	data = nullptr;
+	size = 0;
+#ifdef _WIN32
+	HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (file == INVALID_HANDLE_VALUE) return false;
+	LARGE_INTEGER fileSize{};
+	if (GetFileSizeEx(file, &fileSize) && fileSize.QuadPart > 0) {
+		HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+		if (mapping != NULL) {
+			data = (const unsigned char*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+			size = data != nullptr ? (size_t)fileSize.QuadPart : 0;
+			CloseHandle(mapping);
+		}
+	}
+	CloseHandle(file);
+#else
+	const int fd = open(path, O_RDONLY | O_CLOEXEC);
+	if (fd < 0) return false;
+	struct stat st {};
+	if (fstat(fd, &st) == 0 && st.st_size > 0) {
+		void* mapping = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+		if (mapping != MAP_FAILED) {
+			data = (const unsigned char*)mapping;
+			size = (size_t)st.st_size;
+		}
+	}
+	close(fd);
+#endif
+	return data != nullptr;
+}
+
+static void __UnmapFile(const unsigned char* data, size_t size) {
+	if (data == nullptr) return;
+#ifdef _WIN32
+	UnmapViewOfFile(data);
+#else
+	munmap((void*)data, size);
+#endif
+}
+
+static const char* __RecordStrings(const __CacheRecord* record) {
+	return (const char*)(record + 1);
+}
+
+static bool __CheckRecordCRC(const __CacheRecord* record) {
+	const char* beg = (const char*)record + offsetof(__CacheRecord, offset);
+	return profiler::ComputeCRC32(beg, (int)(record->size - offsetof(__CacheRecord, offset))) == record->crc;
+}
+
+// Null if the record at 'data' is truncated or malformed (the CRC is checked on lookup only)
+static const __CacheRecord* __ValidRecord(const unsigned char* data, size_t available) {
+	if (available < sizeof(__CacheRecord)) return nullptr;
+	const __CacheRecord* record = (const __CacheRecord*)data;
+	if (record->size < sizeof(__CacheRecord) || record->size % 8 != 0 || record->size > available)
+		return nullptr;
+	const size_t strings = (size_t)record->buildIdLen + record->funcNameLen + record->funcNameExtLen + record->fileNameLen + 4;
+	if (strings > record->size - sizeof(__CacheRecord)) return nullptr;
+	const char* str = __RecordStrings(record);
+	for (unsigned int len : { record->buildIdLen, record->funcNameLen, record->funcNameExtLen, record->fileNameLen }) {
+		if (str[len] != '\0') return nullptr;
+		str += len + 1;
+	}
+	return record;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+bool profiler::__OpenSymbolCache(const char* path, const std::vector<ModuleInfo>& modules) {
+	if (gCacheFile != nullptr) fclose(gCacheFile);
+	gCacheFile = nullptr;
+	gCacheIndex.clear();
+	if (path == nullptr) return true;
+
+	std::unordered_set<std::string_view> loaded;
+	for (const ModuleInfo& module : modules)
+		if (!module.buildId.empty()) loaded.insert(module.buildId);
+
+	//////////////////////////////////////////////////////////////////////////////
+	// 1. Map and validate what is already there
+	const unsigned char* data = nullptr;
+	size_t size = 0;
+	__MapFile(path, data, size);
+	bool valid = (size >= sizeof(gCacheMagic) && memcmp(data, gCacheMagic, sizeof(gCacheMagic)) == 0);
+	size_t live = 0, stale = 0, end = sizeof(gCacheMagic);
+	while (valid && end < size) {
+		const __CacheRecord* record = __ValidRecord(data + end, size - end);
+		if (record == nullptr) break; // Damaged tail (e.g. a crash while appending)
+		const std::string_view buildId(__RecordStrings(record), record->buildIdLen);
+		(loaded.count(buildId) ? live : stale)++;
+		end += record->size;
+	}
+
+	//////////////////////////////////////////////////////////////////////////////
+	// 2. Compact (live records only), through a temporary file renamed over the old one
+	if (!valid || end != size || (stale > 0 && stale >= live)) {
+		const std::string tmpPath = std::string(path) + ".tmp";
+		FILE* tmp = fopen(tmpPath.c_str(), "wb");
+		if (tmp == nullptr) {
+			__UnmapFile(data, size);
+			return false;
+		}
+		fwrite(gCacheMagic, 1, sizeof(gCacheMagic), tmp);
+		for (size_t pos = sizeof(gCacheMagic); valid && pos < end; ) {
+			const __CacheRecord* record = (const __CacheRecord*)(data + pos);
+			if (loaded.count(std::string_view(__RecordStrings(record), record->buildIdLen)))
+				fwrite(record, 1, record->size, tmp);
+			pos += record->size;
+		}
+		const bool written = (ferror(tmp) == 0);
+		fclose(tmp);
+		__UnmapFile(data, size);
+		std::error_code error;
+		if (written)
+			std::filesystem::rename(tmpPath, path, error);
+		if (!written || error) {
+			std::filesystem::remove(tmpPath, error);
+			return false;
+		}
+		__MapFile(path, data, size);
+		end = size;
+	}
+
+	//////////////////////////////////////////////////////////////////////////////
+	// 3. Index every record (modules loaded later may still match)
+	for (size_t pos = sizeof(gCacheMagic); pos < end; ) {
+		const __CacheRecord* record = (const __CacheRecord*)(data + pos);
+		gCacheIndex[{ std::string_view(__RecordStrings(record), record->buildIdLen), record->offset }] = record;
+		pos += record->size;
+	}
+	// The mapping is never unmapped from here on: FuncInfo names point into it
+
+	gCacheFile = fopen(path, "ab");
+	return gCacheFile != nullptr;
+}
+
+bool profiler::__FindCachedFuncInfo(const ModuleInfo& module, FuncID func, FuncInfo& info) {
+	if (module.buildId.empty()) return false;
+	auto it = gCacheIndex.find({ module.buildId, (unsigned long long)func - module.bias });
+	if (it == gCacheIndex.end()) return false;
+
+	const __CacheRecord* record = it->second;
+	if (!__CheckRecordCRC(record)) return false; // Re-resolved (and appended again)
+	const char* str = __RecordStrings(record) + record->buildIdLen + 1;
+	info.id = func;
+	info.funcName = str;
+	info.funcNameLen = record->funcNameLen;
+	str += record->funcNameLen + 1;
+	info.funcNameExt = str;
+	info.funcNameExtLen = record->funcNameExtLen;
+	str += record->funcNameExtLen + 1;
+	info.fileName = str;
+	info.fileNameLen = record->fileNameLen;
+	info.fileLine = record->fileLine;
+	return true;
+}
+
+void profiler::__StoreCachedFuncInfo(const ModuleInfo& module, FuncID func, const FuncInfo& info) {
+	if (gCacheFile == nullptr || module.buildId.empty()) return;
+
+	__CacheRecord record{};
+	record.offset = (unsigned long long)func - module.bias;
+	record.fileLine = info.fileLine;
+	record.buildIdLen = (unsigned int)module.buildId.size();
+	record.funcNameLen = info.funcNameLen;
+	record.funcNameExtLen = info.funcNameExtLen;
+	record.fileNameLen = info.fileNameLen;
+	const size_t strings = (size_t)record.buildIdLen + record.funcNameLen + record.funcNameExtLen + record.fileNameLen + 4;
+	record.size = (unsigned int)((sizeof(__CacheRecord) + strings + 7) & ~(size_t)7);
+
+	std::vector<char> buffer(record.size, '\0');
+	char* str = buffer.data() + sizeof(__CacheRecord);
+	for (auto [src, len] : { std::pair<const char*, unsigned int>{ module.buildId.c_str(), record.buildIdLen },
+		{ info.funcName, record.funcNameLen }, { info.funcNameExt, record.funcNameExtLen }, { info.fileName, record.fileNameLen } }) {
+		memcpy(str, src, len);
+		str += len + 1;
+	}
+	memcpy(buffer.data(), &record, sizeof(record));
+	const size_t crcOffset = offsetof(__CacheRecord, offset);
+	record.crc = ComputeCRC32(buffer.data() + crcOffset, (int)(record.size - crcOffset));
+	memcpy(buffer.data(), &record, sizeof(record));
+
+	// One write per record: a crash leaves at most a damaged tail, dropped on the next open
+	fwrite(buffer.data(), 1, buffer.size(), gCacheFile);
+	fflush(gCacheFile);
+}
@@ -0,0 +1,206 @@
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <memory>
+#include <algorithm>
+#include <unordered_map>
+
+#include "../ProfilerLib/profilerlib.hpp"
+#include "../ProfilerLib/profilerlib_elf.hpp"
+
+//////////////////////////////////////////////////////////////////////////////
+// profiler-symbolize <dump> [-d <dir>]...
+// Turns a dump written by 'profiler::DumpStats' / 'profiler::DumpHistory' into named output.
+// Modules are looked up at their recorded path first, then by file name inside every '-d' directory.
+// A module whose build-id differs from the recorded one is never used.
+
+struct Module {
+    profiler::ModuleInfo info;
+    std::unique_ptr<profiler::elf::ElfImage> image;
+    bool opened = false;
+};
+
+struct Symbol {
+    std::string name;
+    int line = 0;
+};
+
+struct StatsRecord {
+    unsigned long long func;
+    int count;
+    long long tot, min, max; // Ticks
+    long long self, collapsed;
+};
+
+struct HistoryRecord {
+    unsigned long long func; // 0 for exits
+    unsigned long long time;
+};
+
+static std::vector<std::string> gSearchDirs;
+static std::vector<Module> gModules;
+static std::unordered_map<unsigned long long, Symbol> gSymbols;
+static double gNsPerTick = 1.0;
+
+static const char* baseName(const std::string& path) {
+    size_t pos = path.find_last_of("/\\");
+    return path.c_str() + (pos == std::string::npos ? 0 : pos + 1);
+}
+
+static profiler::elf::ElfImage* openImage(Module& module) {
+    if (module.opened) return module.image.get();
+    module.opened = true;
+
+    std::vector<std::string> candidates{ module.info.path };
+    for (const std::string& dir : gSearchDirs)
+        candidates.push_back(dir + "/" + baseName(module.info.path));
+    for (const std::string& path : candidates) {
+        auto image = std::make_unique<profiler::elf::ElfImage>();
+        if (!image->open(path.c_str())) continue;
+        if (!module.info.buildId.empty() && image->buildId() != module.info.buildId) {
+            fprintf(stderr, "[!] %s: build-id mismatch (stale module), skipped\n", path.c_str());
+            continue;
+        }
+        module.image = std::move(image);
+        return module.image.get();
+    }
+    fprintf(stderr, "[!] %s: not found\n", module.info.path.c_str());
+    return nullptr;
+}
+
+static const Symbol& resolve(unsigned long long func) {
+    auto it = gSymbols.find(func);
+    if (it != gSymbols.end()) return it->second;
+
+    Symbol symbol{};
+    char buffer[1024] = { '\0' };
+    snprintf(buffer, sizeof(buffer), "0x%llx", func);
+    for (Module& module : gModules) {
+        if (func - module.info.base >= module.info.size) continue;
+        unsigned long long vaddr = func - module.info.bias;
+        snprintf(buffer, sizeof(buffer), "%s+0x%llx", baseName(module.info.path), vaddr);
+        profiler::elf::ElfImage* image = openImage(module);
+        if (image == nullptr) break;
+        const profiler::elf::ElfSymbol* sym = image->findSymbol(vaddr);
+        if (sym == nullptr) break;
+        profiler::elf::Demangle(sym->name, buffer, sizeof(buffer));
+        const char* file = nullptr;
+        image->findLine(vaddr, file, symbol.line);
+        break;
+    }
+    symbol.name = buffer;
+    return gSymbols.emplace(func, std::move(symbol)).first->second;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+static void printStats(std::vector<StatsRecord>& stats) {
+    std::sort(stats.begin(), stats.end(), [](const StatsRecord& a, const StatsRecord& b) {
+        return a.tot > b.tot;
+    });
+    for (const StatsRecord& r : stats) {
+        const Symbol& symbol = resolve(r.func);
+        const double usPerTick = gNsPerTick / 1'000.0;
+        printf(
+            "%-64.64s.%-4d | Max: %12.3f (us) | Min: %12.3f (us) | Avg: %12.3f (us) | Tot: %12.3f (us) | Self: %12.3f (us) | Incl: %12.3f (us) | Count: %d\n",
+            symbol.name.c_str(),
+            symbol.line,
+            r.max * usPerTick,
+            r.min * usPerTick,
+            r.count > 0 ? r.tot * usPerTick / r.count : 0.0,
+            r.tot * usPerTick,
+            r.self * usPerTick,
+            r.collapsed * usPerTick,
+            r.count
+        );
+    }
+}
+
+static void printHistory(const std::vector<HistoryRecord>& history) {
+    std::vector<HistoryRecord> callstack;
+    for (const HistoryRecord& r : history) {
+        if (r.func != 0) {
+            callstack.push_back(r);
+            const Symbol& symbol = resolve(r.func);
+            printf("%*.s[+] %-s.%-3d\n", (unsigned int)(callstack.size() - 1) * 2, "", symbol.name.c_str(), symbol.line);
+        }
+        else {
+            if (callstack.empty()) continue;
+            HistoryRecord start = callstack.back();
+            const Symbol& symbol = resolve(start.func);
+            printf(
+                "%*.s[-] %-s.%03d, time: %.3f (us)\n",
+                (unsigned int)(callstack.size() - 1) * 2,
+                "",
+                symbol.name.c_str(),
+                symbol.line,
+                (r.time - start.time) * gNsPerTick / 1'000.0
+            );
+            callstack.pop_back();
+        }
+    }
+}
+
+int main(int argc, char* argv[]) {
+    const char* dumpPath = nullptr;
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "-d") == 0 && i + 1 < argc)
+            gSearchDirs.push_back(argv[++i]);
+        else if (dumpPath == nullptr && argv[i][0] != '-')
+            dumpPath = argv[i];
+        else {
+            dumpPath = nullptr;
+            break;
+        }
+    }
+    if (dumpPath == nullptr) {
+        fprintf(stderr, "usage: %s <dump> [-d <dir>]...\n", argv[0]);
+        return 2;
+    }
+
+    FILE* file = fopen(dumpPath, "r");
+    if (file == nullptr) {
+        fprintf(stderr, "[!] %s: cannot open\n", dumpPath);
+        return 1;
+    }
+
+    //////////////////////////////////////////////////////////////////////////////
+    // Parse the dump (format: see 'profilerlib_dump.cpp')
+    std::vector<StatsRecord> stats;
+    std::vector<HistoryRecord> history;
+    char line[8192];
+    int version = 0;
+    bool valid = fgets(line, sizeof(line), file) != nullptr && sscanf(line, "profiler-dump %d", &version) == 1 && version == 2;
+    while (valid && fgets(line, sizeof(line), file) != nullptr) {
+        line[strcspn(line, "\r\n")] = '\0';
+        Module module{};
+        StatsRecord s{};
+        HistoryRecord h{};
+        int pathOffset = 0;
+        char buildId[256] = { '\0' };
+        if (sscanf(line, "clock %lf", &gNsPerTick) == 1) {}
+        else if (sscanf(line, "module %llx %llx %llx %255s %n", &module.info.base, &module.info.size, &module.info.bias, buildId, &pathOffset) == 4 && pathOffset > 0) {
+            module.info.buildId = strcmp(buildId, "-") == 0 ? "" : buildId;
+            module.info.path = line + pathOffset;
+            gModules.push_back(std::move(module));
+        }
+        else if (sscanf(line, "stats %llx %d %lld %lld %lld %lld %lld", &s.func, &s.count, &s.tot, &s.min, &s.max, &s.self, &s.collapsed) == 7)
+            stats.push_back(s);
+        else if (sscanf(line, "enter %llx %llu", &h.func, &h.time) == 2)
+            history.push_back(h);
+        else if (sscanf(line, "exit %llu", &h.time) == 1)
+            history.push_back({ 0, h.time });
+        else
+            valid = false;
+    }
+    fclose(file);
+    if (!valid) {
+        fprintf(stderr, "[!] %s: not a profiler dump (or unsupported version)\n", dumpPath);
+        return 1;
+    }
+
+    if (!stats.empty()) printStats(stats);
+    if (!history.empty()) printHistory(history);
+    return 0;
+}
@@ -0,0 +1,423 @@
+#include <cstdio>
+#include <cstring>
+#include <cmath>
+#include <cstdint>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "../ProfilerLib/profilerlib.hpp"
+
+//////////////////////////////////////////////////////////////////////////////
+// ProfilerTests [<case>]
+// Not instrumented: events are raised by calling the hooks by hand, with fake FuncIDs.
+// Each case runs in its own process (see CMakeLists.txt): the profiler state is process-wide.
+
+static int gFailures = 0;
+
+#define CHECK(cond) \
+    do { \
+        if (!(cond)) { \
+            printf("%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); \
+            ++gFailures; \
+        } \
+    } while (0)
+
+#define CHECK_NEAR(a, b) CHECK(std::fabs((double)(a) - (double)(b)) <= 1e-9 * std::max({ 1.0, std::fabs((double)(a)), std::fabs((double)(b)) }))
+
+static profiler::FuncID FakeFunc(int n) {
+    return (profiler::FuncID)(uintptr_t)(0x10000 + n * 0x10);
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// History
+
+struct Event {
+    profiler::FuncID id; // EmptyFuncID for exits
+    profiler::TimeStamp time;
+};
+
+static void Push(profiler::FrameHistory& history, std::vector<Event>& events, profiler::FuncIndex func, profiler::TimeStamp time) {
+    if (func != ~0u) history.pushEnter(func, time);
+    else history.pushExit(time);
+    events.push_back({ func != ~0u ? profiler::__GetFuncIDFromIndex(func) : profiler::EmptyFuncID, time });
+}
+
+static std::vector<Event> Decode(const profiler::FrameHistory& history) {
+    std::vector<Event> events;
+    for (const auto& e : history)
+        events.push_back({ e.id, e.time });
+    return events;
+}
+
+static bool SameEvents(const std::vector<Event>& decoded, const Event* expected) {
+    for (size_t i = 0; i < decoded.size(); ++i)
+        if (decoded[i].id != expected[i].id || decoded[i].time != expected[i].time)
+            return false;
+    return true;
+}
+
+// Enters and exits alternate, 'delta(i)' ticks apart
+template<typename Delta>
+static std::vector<Event> Fill(profiler::FrameHistory& history, size_t count, Delta delta) {
+    const profiler::FuncIndex func = profiler::__InternFuncID(FakeFunc(0));
+    std::vector<Event> events;
+    profiler::TimeStamp time = 1'000'000'000'000;
+    for (size_t i = 0; i < count; ++i) {
+        time += delta(i);
+        Push(history, events, (i % 2 == 0) ? func : ~0u, time);
+    }
+    return events;
+}
+
+static void TestHistory() {
+    const profiler::FuncIndex a = profiler::__InternFuncID(FakeFunc(0));
+    const profiler::FuncIndex b = profiler::__InternFuncID(FakeFunc(1));
+
+    // 1. Round trip, every encoding: small deltas, deltas past an enter's 30 bits (time escape), large exit deltas
+    {
+        profiler::FrameHistory history(2 * profiler::FrameHistoryChunkSize);
+        std::vector<Event> expected;
+        profiler::TimeStamp time = 1'000'000'000'000;
+        for (int i = 0; i < 1000; ++i) {
+            Push(history, expected, (i % 3 == 0) ? b : a, time += 3);
+            Push(history, expected, a, time += (i % 7 == 0) ? (1ull << 31) : (1ull << 29));
+            Push(history, expected, ~0u, time += (i % 5 == 0) ? (1ull << 40) : 1);
+            Push(history, expected, ~0u, time += 0);
+        }
+        std::vector<Event> decoded = Decode(history);
+        CHECK(decoded.size() == expected.size());
+        CHECK(SameEvents(decoded, expected.data()));
+        CHECK(history.size() > expected.size()); // Time escapes are stored too
+        CHECK(history.dropped() == 0);
+        CHECK(history.backTime() == time);
+
+        for (auto it = history.begin(); it != history.end(); ++it)
+            if (it->id != profiler::EmptyFuncID)
+                CHECK(it.funcIndex() == ((it->id == FakeFunc(1)) ? b : a));
+
+        // Copies decode the same, moved-from histories are empty and reusable
+        profiler::FrameHistory copy = history;
+        CHECK(SameEvents(Decode(copy), expected.data()));
+        profiler::FrameHistory moved = std::move(history);
+        CHECK(SameEvents(Decode(moved), expected.data()));
+        CHECK(history.empty() && history.capacity() == 0 && history.begin() == history.end());
+        history.reserve(profiler::FrameHistoryChunkSize, profiler::OverflowPolicy::DropNewest);
+        std::vector<Event> reused;
+        Push(history, reused, a, 42);
+        Push(history, reused, ~0u, 43);
+        CHECK(Decode(history).size() == 2 && SameEvents(Decode(history), reused.data()));
+    }
+
+    // 2. DropNewest: keeps the frame's beginning
+    {
+        const size_t count = profiler::FrameHistoryChunkSize + 1000;
+        profiler::FrameHistory history(profiler::FrameHistoryChunkSize, profiler::OverflowPolicy::DropNewest);
+        std::vector<Event> expected = Fill(history, count, [](size_t) { return 1ull; });
+        std::vector<Event> decoded = Decode(history);
+        CHECK(history.size() == history.capacity());
+        CHECK(decoded.size() + history.dropped() == count);
+        CHECK(SameEvents(decoded, expected.data()));
+    }
+
+    // 3. DropOldest: keeps the frame's end, decoding starts past the overwritten events (time escapes included)
+    {
+        const size_t count = 3 * profiler::FrameHistoryChunkSize + 123;
+        profiler::FrameHistory history(profiler::FrameHistoryChunkSize, profiler::OverflowPolicy::DropOldest);
+        std::vector<Event> expected = Fill(history, count, [](size_t i) { return (i % 100 == 0) ? (1ull << 31) : 1ull; });
+        std::vector<Event> decoded = Decode(history);
+        CHECK(history.size() == history.capacity());
+        CHECK(history.dropped() > 0);
+        CHECK(decoded.size() < count);
+        CHECK(SameEvents(decoded, expected.data() + (count - decoded.size())));
+        CHECK(history.backTime() == expected.back().time);
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// Stats (Welford / Chan merge)
+
+static void TestStatsMerge() {
+    // Deterministic samples (LCG), spread over a few orders of magnitude
+    std::vector<profiler::DeltaTicks> samples;
+    unsigned long long seed = 12345;
+    for (int i = 0; i < 10'000; ++i) {
+        seed = seed * 6364136223846793005ull + 1442695040888963407ull;
+        samples.push_back((profiler::DeltaTicks)((seed >> 33) % (1 + (i % 4) * 250'000)) + 1'000'000);
+    }
+
+    // Naive: two passes
+    profiler::DeltaTicks tot = 0;
+    profiler::DeltaTicks min = samples[0], max = samples[0];
+    for (profiler::DeltaTicks s : samples) {
+        tot += s;
+        min = std::min(min, s);
+        max = std::max(max, s);
+    }
+    const double mean = (double)tot / samples.size();
+    double m2 = 0;
+    for (profiler::DeltaTicks s : samples)
+        m2 += ((double)s - mean) * ((double)s - mean);
+
+    // Streaming, then uneven parts merged (an empty one included, on both sides)
+    profiler::FuncStats whole{};
+    for (profiler::DeltaTicks s : samples)
+        whole.record(s);
+    const size_t cuts[] = { 0, 1, 1, 777, 5'000, samples.size() };
+    profiler::FuncStats merged{};
+    for (size_t part = 0; part + 1 < std::size(cuts); ++part) {
+        profiler::FuncStats stats{};
+        for (size_t i = cuts[part]; i < cuts[part + 1]; ++i)
+            stats.record(samples[i]);
+        merged.merge(stats);
+    }
+
+    for (const profiler::FuncStats* stats : { &whole, &merged }) {
+        CHECK(stats->invocationCount == (int)samples.size());
+        CHECK(stats->ticksTot == tot);
+        CHECK(stats->ticksMin == min);
+        CHECK(stats->ticksMax == max);
+        CHECK_NEAR(stats->ticksMean, mean);
+        CHECK_NEAR(stats->ticksM2, m2);
+        CHECK_NEAR(stats->ticksVariance(), m2 / (samples.size() - 1));
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// Aggregation modes: the stats of each mode must match a naive replay of the frame it aggregated
+
+constexpr int CallsA = 2, CallsB = 3, CallsC = 1; // Per repetition (see 'RunCalls')
+
+static void RunCalls(int repeat) {
+    const profiler::FuncID a = FakeFunc(0), b = FakeFunc(1), c = FakeFunc(2);
+    for (int r = 0; r < repeat; ++r) {
+        PEnter(a);
+        PEnter(b); PEnter(c); PExit(nullptr); PExit(nullptr);
+        PEnter(b); PEnter(b); PExit(nullptr); PExit(nullptr); // Recursion
+        PEnter(a); PExit(nullptr);                           // Recursion
+        PExit(nullptr);
+    }
+}
+
+struct Reference {
+    std::vector<profiler::DeltaTicks> samples;
+    profiler::DeltaTicks self = 0;
+    profiler::DeltaTicks collapsed = 0;
+};
+
+static std::unordered_map<profiler::FuncID, Reference> NaiveReplay(const profiler::FrameHistory& history) {
+    struct Call {
+        profiler::FuncID func;
+        profiler::TimeStamp start;
+        profiler::DeltaTicks children;
+    };
+    std::unordered_map<profiler::FuncID, Reference> reference;
+    std::vector<Call> stack;
+    for (const auto& e : history) {
+        if (e.id != profiler::EmptyFuncID) {
+            stack.push_back({ e.id, e.time, 0 });
+            continue;
+        }
+        if (stack.empty()) continue;
+        const Call call = stack.back();
+        stack.pop_back();
+        const profiler::DeltaTicks delta = (profiler::DeltaTicks)(e.time - call.start);
+        bool outermost = true;
+        for (const Call& caller : stack)
+            outermost &= (caller.func != call.func);
+        Reference& ref = reference[call.func];
+        ref.samples.push_back(delta);
+        ref.self += delta - call.children;
+        ref.collapsed += outermost ? delta : 0;
+        if (!stack.empty())
+            stack.back().children += delta;
+    }
+    return reference;
+}
+
+static void CheckStats(const profiler::StatsTable& stats, const profiler::FrameHistory& history, int repeat) {
+    CHECK(history.dropped() == 0);
+    const auto reference = NaiveReplay(history);
+    CHECK(reference.size() == 3);
+    CHECK(stats.size() == reference.size());
+    for (const auto& [func, ref] : reference) {
+        const profiler::FuncStats* s = stats.find(func);
+        CHECK(s != nullptr);
+        if (s == nullptr) continue;
+        profiler::DeltaTicks tot = 0;
+        for (profiler::DeltaTicks sample : ref.samples)
+            tot += sample;
+        const double mean = (double)tot / ref.samples.size();
+        double m2 = 0;
+        for (profiler::DeltaTicks sample : ref.samples)
+            m2 += ((double)sample - mean) * ((double)sample - mean);
+        CHECK(s->invocationCount == (int)ref.samples.size());
+        CHECK(s->ticksTot == tot);
+        CHECK(s->ticksMin == *std::min_element(ref.samples.begin(), ref.samples.end()));
+        CHECK(s->ticksMax == *std::max_element(ref.samples.begin(), ref.samples.end()));
+        CHECK(s->ticksSelfTot == ref.self);
+        CHECK(s->ticksCollapsedTot == ref.collapsed);
+        CHECK(std::fabs(s->ticksMean - mean) <= 1e-6 * std::max(1.0, mean));
+        CHECK(std::fabs(s->ticksM2 - m2) <= 1e-6 * std::max(1.0, m2));
+        const profiler::LatencyHistogram* histogram = stats.findHistogram(func);
+        CHECK(histogram != nullptr && histogram->count() == ref.samples.size());
+    }
+    // Same call sequence, same counts, whatever the mode
+    const profiler::FuncStats* a = stats.find(FakeFunc(0));
+    const profiler::FuncStats* b = stats.find(FakeFunc(1));
+    const profiler::FuncStats* c = stats.find(FakeFunc(2));
+    CHECK(a != nullptr && a->invocationCount == CallsA * repeat);
+    CHECK(b != nullptr && b->invocationCount == CallsB * repeat);
+    CHECK(c != nullptr && c->invocationCount == CallsC * repeat);
+}
+
+// Replay / Online / parallel Replay: stats of the caller, history of its last frame
+static void TestAggregationSync(profiler::AggregationMode mode, int repeat) {
+    profiler::SetAggregationMode(mode);
+    profiler::Enable();
+    profiler::FrameStart();
+    RunCalls(repeat);
+    profiler::FrameEnd();
+    profiler::FrameStart(); // The frame just ended becomes 'GetFrameHistory'
+    profiler::Disable();
+    const profiler::FrameHistory history = profiler::GetFrameHistory();
+    CheckStats(profiler::GetStatsTable(), history, repeat);
+}
+
+static void TestAggregationReplay() {
+    TestAggregationSync(profiler::AggregationMode::Replay, 1'000);
+}
+
+static void TestAggregationOnline() {
+    TestAggregationSync(profiler::AggregationMode::Online, 1'000);
+}
+
+static void TestAggregationParallel() {
+    // Large enough to be cut into chunks (see 'SetAggregationThreads'), within the default history capacity
+    constexpr int repeat = 16'000;
+    static_assert(12 * repeat < profiler::FrameHistoryDefaultCapacity); // 12 events per repetition
+    profiler::SetAggregationThreads(4);
+    TestAggregationSync(profiler::AggregationMode::Replay, repeat);
+
+    // The parallel path itself, on the very same frame
+    const profiler::FrameHistory history = profiler::GetFrameHistory();
+    profiler::StatsTable frame{};
+    std::vector<profiler::FuncIndex> touched;
+    CHECK(profiler::__AggregateParallel(history, frame, touched));
+    CHECK(touched.size() == 3);
+    CheckStats(frame, history, repeat);
+    profiler::SetAggregationThreads(1);
+}
+
+static void TestAggregationBackground() {
+    std::mutex lock;
+    profiler::FrameHistory collectedFrame;
+    profiler::StatsTable collectedStats;
+    int collected = 0;
+    profiler::SetCollectorCallback([&](profiler::ThreadIndex, const profiler::FrameHistory& frame, const profiler::StatsTable& stats) {
+        std::lock_guard<std::mutex> guard(lock);
+        collectedFrame = frame;
+        collectedStats = stats;
+        ++collected;
+    });
+    profiler::SetAggregationMode(profiler::AggregationMode::Background);
+    profiler::Enable();
+    profiler::FrameStart();
+    RunCalls(1'000);
+    profiler::FrameEnd();
+    profiler::Disable();
+    profiler::SetAggregationMode(profiler::AggregationMode::Replay); // Stops the collector, once drained
+    CHECK(collected == 1);
+    CheckStats(collectedStats, collectedFrame, 1'000);
+    // The caller reads back the frame the collector aggregated
+    CHECK(SameEvents(Decode(profiler::GetFrameHistory()), Decode(collectedFrame).data()));
+    CHECK(Decode(profiler::GetFrameHistory()).size() == Decode(collectedFrame).size());
+
+    // Frames submitted while the collector is a whole queue behind are dropped, and counted
+    constexpr int frames = 32;
+    profiler::SetAggregationMode(profiler::AggregationMode::Background);
+    profiler::Enable();
+    {
+        std::lock_guard<std::mutex> stall(lock); // Blocks the collector in the callback
+        for (int f = 0; f < frames; ++f) {
+            profiler::FrameStart();
+            RunCalls(1);
+            profiler::FrameEnd();
+        }
+    }
+    profiler::Disable();
+    profiler::SetAggregationMode(profiler::AggregationMode::Replay);
+    profiler::SetCollectorCallback(nullptr);
+    CHECK(profiler::GetDroppedFrames() > 0);
+    CHECK(collected - 1 + (int)profiler::GetDroppedFrames() == frames);
+}
+
+// Background -> Replay -> Background: the collector goes on from the stats of the frames replayed meanwhile
+static void TestAggregationModeSwitch() {
+    std::mutex lock;
+    profiler::StatsTable collectedStats;
+    profiler::SetCollectorCallback([&](profiler::ThreadIndex, const profiler::FrameHistory&, const profiler::StatsTable& stats) {
+        std::lock_guard<std::mutex> guard(lock);
+        collectedStats = stats;
+    });
+    constexpr int repeat = 100;
+    const profiler::AggregationMode modes[] = {
+        profiler::AggregationMode::Background, profiler::AggregationMode::Background,
+        profiler::AggregationMode::Replay, profiler::AggregationMode::Replay,
+        profiler::AggregationMode::Background,
+    };
+    profiler::Enable();
+    for (profiler::AggregationMode mode : modes) {
+        profiler::SetAggregationMode(mode);
+        profiler::FrameStart();
+        RunCalls(repeat);
+        profiler::FrameEnd();
+    }
+    profiler::Disable();
+    profiler::SetAggregationMode(profiler::AggregationMode::Replay); // Stops the collector, once drained
+    profiler::SetCollectorCallback(nullptr);
+
+    profiler::StatsTable published;
+    CHECK(profiler::GetThreadStatsTable(0, published));
+    for (const profiler::StatsTable* stats : { &collectedStats, &published }) {
+        const profiler::FuncStats* a = stats->find(FakeFunc(0));
+        const profiler::FuncStats* c = stats->find(FakeFunc(2));
+        CHECK(a != nullptr && a->invocationCount == CallsA * repeat * (int)std::size(modes));
+        CHECK(c != nullptr && c->invocationCount == CallsC * repeat * (int)std::size(modes));
+        const profiler::LatencyHistogram* histogram = stats->findHistogram(FakeFunc(2));
+        CHECK(histogram != nullptr && histogram->count() == (unsigned long long)(CallsC * repeat * std::size(modes)));
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+struct TestCase {
+    const char* name;
+    void (*run)();
+};
+
+static const TestCase gTests[] = {
+    { "history", TestHistory },
+    { "stats-merge", TestStatsMerge },
+    { "aggregation-replay", TestAggregationReplay },
+    { "aggregation-online", TestAggregationOnline },
+    { "aggregation-parallel", TestAggregationParallel },
+    { "aggregation-background", TestAggregationBackground },
+    { "aggregation-mode-switch", TestAggregationModeSwitch },
+};
+
+int main(int argc, char* argv[]) {
+    int ran = 0;
+    for (const TestCase& test : gTests) {
+        if (argc > 1 && strcmp(argv[1], test.name) != 0) continue;
+        printf("[%s]\n", test.name);
+        test.run();
+        ++ran;
+    }
+    if (ran == 0) {
+        printf("Unknown test case: '%s'\n", argv[1]);
+        return 1;
+    }
+    printf("%d failure(s)\n", gFailures);
+    return gFailures == 0 ? 0 : 1;
+}